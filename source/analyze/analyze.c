@@ -0,0 +1,776 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "faketabletd.h"
+#include "utilities.h"
+#include "reportfile.h"
+#include "output.h"
+#include "mapping.h"
+
+#include "drivers/model/model.h"
+#include "model_config.h"
+#include "drivers/rdesc/rdesc.h"
+
+// Intervals this many times longer than the usual one are counted as gaps,
+// most likely reports the device or the host dropped
+#define ANALYZE_GAP_FACTOR          1.5
+
+// Anything longer than this is the pen leaving the tablet alone for a while
+#define ANALYZE_IDLE_NS             100000000ULL
+
+// How many values a batch engine gets wrong before we stop listing them
+#define ANALYZE_MAX_MISMATCHES      10
+
+#define ANALYZE_TYPE_PEN            0
+#define ANALYZE_TYPE_FRAME          1
+#define ANALYZE_TYPE_DIAL           2
+#define ANALYZE_TYPE_OTHER          3
+#define ANALYZE_TYPE_COUNT          4
+
+static const char *type_names[ANALYZE_TYPE_COUNT] = { "pen", "frame", "dial", "other" };
+
+struct type_stats_t
+{
+    size_t reports;
+    uint64_t decode_ns;
+    size_t events;
+};
+
+static const int kind_types[] =
+{
+    [MODEL_KIND_OTHER] = ANALYZE_TYPE_OTHER,
+    [MODEL_KIND_PEN] = ANALYZE_TYPE_PEN,
+    [MODEL_KIND_FRAME] = ANALYZE_TYPE_FRAME,
+    [MODEL_KIND_DIAL] = ANALYZE_TYPE_DIAL,
+};
+
+// Every report decoded in one go, up front. What kind of report each one
+// is and the pen's flags come from here for the rest of the analysis
+static struct model_batch_t batch;
+
+static void batch_free(struct model_batch_t *batch)
+{
+    free(batch->kinds);
+    free(batch->flags);
+    free(batch->x);
+    free(batch->y);
+    free(batch->pressure);
+    free(batch->tilt_x);
+    free(batch->tilt_y);
+    free(batch->buttons);
+    free(batch->dial);
+    *batch = (struct model_batch_t){};
+}
+
+static int batch_alloc(struct model_batch_t *batch, size_t count)
+{
+    batch->kinds = malloc(count * sizeof(uint8_t));
+    batch->flags = malloc(count * sizeof(uint8_t));
+    batch->x = malloc(count * sizeof(int32_t));
+    batch->y = malloc(count * sizeof(int32_t));
+    batch->pressure = malloc(count * sizeof(uint16_t));
+    batch->tilt_x = malloc(count * sizeof(int16_t));
+    batch->tilt_y = malloc(count * sizeof(int16_t));
+    batch->buttons = malloc(count * sizeof(uint16_t));
+    batch->dial = malloc(count * sizeof(uint8_t));
+
+    if(batch->kinds == NULL || batch->flags == NULL || batch->x == NULL || batch->y == NULL || batch->pressure == NULL ||
+        batch->tilt_x == NULL || batch->tilt_y == NULL || batch->buttons == NULL || batch->dial == NULL)
+    {
+        __ERROR("cannot allocate memory for %zu decoded reports", count);
+        batch_free(batch);
+        return -1;
+    }
+    return 0;
+}
+
+// Decodes the whole capture passes times over, and returns how long that
+// took in total
+static uint64_t analyze_batch(const struct report_file_t *file, size_t passes)
+{
+    uint64_t start = get_time_ns();
+
+    for(size_t pass = 0; pass < passes; pass++)
+        hs610_decode_batch(file->reports, file->count, &batch);
+    return get_time_ns() - start;
+}
+
+static inline bool pen_in_range(size_t index)
+{
+    return batch.kinds[index] == MODEL_KIND_PEN && (batch.flags[index] & MODEL_IN_RANGE);
+}
+
+// Keeps the compiler from leaving the filter out
+static volatile int32_t smoothing_sink;
+
+// What smoothing adds to every pen report in range, going through the
+// decoded positions the way the driver would. Returns the total time spent
+static uint64_t analyze_smoothing(const struct report_file_t *file, size_t passes, const struct filter_t *filter, size_t *count)
+{
+    int32_t x = 0, y = 0, pressure = 0;
+    uint64_t start = 0, total = 0;
+    struct filter_state_t state;
+
+    *count = 0;
+    for(size_t pass = 0; pass < passes; pass++)
+    {
+        state = (struct filter_state_t){};
+        start = get_time_ns();
+        for(size_t i = 0; i < file->count; i++)
+        {
+            if(!pen_in_range(i))
+                continue;
+
+            x = batch.x[i];
+            y = batch.y[i];
+            pressure = batch.pressure[i];
+            filter_apply(filter, &state, file->reports[i].timestamp, &x, &y, &pressure);
+
+            smoothing_sink = x ^ y ^ pressure;
+            (*count)++;
+        }
+        total += get_time_ns() - start;
+    }
+    return total;
+}
+
+static inline int report_type(size_t index)
+{
+    return kind_types[batch.kinds[index]];
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const uint64_t *sorted, size_t count, double p)
+{
+    return sorted[MIN((size_t)(p * (count - 1) + 0.5), count - 1)] / 1e6;
+}
+
+static void analyze_timing(const struct report_file_t *file)
+{
+    size_t count = file->count - 1, gaps = 0, missing = 0, idle = 0;
+    uint64_t *intervals = NULL, *sorted = NULL, interval = 0, median = 0;
+    uint64_t duration = file->reports[file->count - 1].timestamp, in_range = 0, touching = 0;
+    double mean = 0, variance = 0;
+
+    intervals = malloc(count * sizeof(uint64_t));
+    sorted = malloc(count * sizeof(uint64_t));
+    if(intervals == NULL || sorted == NULL)
+    {
+        __ERROR("cannot allocate memory for %zu intervals", count);
+        free(intervals);
+        free(sorted);
+        return;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        intervals[i] = sorted[i] = file->reports[i + 1].timestamp - file->reports[i].timestamp;
+        mean += intervals[i];
+    }
+    mean /= count;
+    qsort(sorted, count, sizeof(uint64_t), compare_u64);
+    median = sorted[count / 2];
+
+    for(size_t i = 0; i < count; i++)
+    {
+        interval = intervals[i];
+        variance += (interval - mean) * (interval - mean);
+
+        if(interval > ANALYZE_IDLE_NS)
+        {
+            idle++;
+            continue;
+        }
+
+        if(median > 0 && interval > median * ANALYZE_GAP_FACTOR)
+        {
+            gaps++;
+            missing += (interval + median / 2) / median - 1;
+        }
+
+        // The pen stays wherever the last report left it until the next one
+        if(report_type(i) == ANALYZE_TYPE_PEN)
+        {
+            if(batch.flags[i] & MODEL_IN_RANGE)
+                in_range += interval;
+            if(batch.flags[i] & MODEL_TOUCH)
+                touching += interval;
+        }
+    }
+    variance /= count;
+
+    printf(
+        "duration:       %.3f s (%.1f reports/s)\n",
+        duration / 1e9, duration > 0 ? file->count / (duration / 1e9) : 0.0
+    );
+    printf(
+        "intervals:      min %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        sorted[0] / 1e6, percentile(sorted, count, 0.5), percentile(sorted, count, 0.9),
+        percentile(sorted, count, 0.99), sorted[count - 1] / 1e6
+    );
+    printf("jitter:         %.3f ms mean, %.3f ms standard deviation\n", mean / 1e6, sqrt(variance) / 1e6);
+    printf(
+        "gaps:           %zu over %.1fx the median interval, about %zu reports missing, %zu idle periods over %llu ms\n",
+        gaps, ANALYZE_GAP_FACTOR, missing, idle, ANALYZE_IDLE_NS / 1000000ULL
+    );
+    printf(
+        "pen:            in range %.3f s (%.1f%%), touching %.3f s (%.1f%%)\n",
+        in_range / 1e9, duration > 0 ? 100.0 * in_range / duration : 0.0,
+        touching / 1e9, duration > 0 ? 100.0 * touching / duration : 0.0
+    );
+
+    free(intervals);
+    free(sorted);
+}
+
+// Reads back whatever the driver wrote, so the pipe never fills up
+static size_t drain_events(int fd)
+{
+    ssize_t size = 0;
+    size_t events = 0;
+    struct input_event buffer[64];
+
+    while((size = read(fd, buffer, sizeof(buffer))) > 0)
+        events += size / sizeof(struct input_event);
+    return events;
+}
+
+// Events a sink took so far. The null sink doesn't keep track
+static uint64_t sink_events(const struct sink_state_t *state)
+{
+    return state->events + state->record_count + state->records_dropped;
+}
+
+// Big enough that we'd rather not have them on the stack
+static struct output_t output;
+static struct sink_state_t sink_state;
+static struct hid_plan_t plan;
+static struct mapping_t mapping;
+static struct filter_t filter;
+static struct predict_t predict;
+
+// No curve, pressure goes out the way it came in
+static struct pressure_t pressure;
+
+// Writes whatever the memory sink kept to path
+static int dump_events(const char *path)
+{
+    int ret = 0;
+    FILE *stream = NULL;
+
+    if((stream = fopen(path, "w")) == NULL)
+    {
+        __ERROR("cannot create \"%s\": %s", path, strerror(errno));
+        return -1;
+    }
+
+    if((ret = memory_sink_dump(&sink_state, stream)) < 0 || fclose(stream) != 0)
+    {
+        __ERROR("cannot write events to \"%s\": %s", path, strerror(errno));
+        if(ret < 0)
+            fclose(stream);
+        return -1;
+    }
+
+    printf("events:         %zu written to %s", sink_state.record_count, path);
+    if(sink_state.records_dropped > 0)
+        printf(", %zu more didn't fit", sink_state.records_dropped);
+    printf("\n");
+    return 0;
+}
+
+// Runs every report through the real driver (or the one decoding through
+// the report descriptor, if use_plan is set). Events either go to a pipe
+// we count them on (sink is NULL) or to sink, which leaves the syscalls out.
+// With dump_path set, what the memory sink kept ends up there
+static int analyze_decode(const struct report_file_t *file, size_t passes, const struct sink_t *sink, bool use_io_uring, bool use_plan,
+    bool use_smoothing, bool use_prediction, const char *dump_path)
+{
+    int fds[2] = { -1, -1 }, handles[SINK_DEVICE_COUNT], type = 0;
+    bool failed = false;
+    uint64_t start = 0, total_ns = 0, sink_seen = 0;
+    size_t total_reports = 0, total_events = 0;
+    struct driver_state_t state;
+    struct type_stats_t stats[ANALYZE_TYPE_COUNT] = {};
+    struct raw_input_data_t data = (struct raw_input_data_t){};
+    const struct report_t *report = NULL;
+
+    output_init(&output);
+
+    if(sink == NULL)
+    {
+        if(pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            __ERROR("cannot create event pipe: %s", strerror(errno));
+            return -1;
+        }
+
+        data.pad_device = data.pen_device = data.mouse_device = data.keyboard_device = fds[1];
+        output_setup(&output, NULL, NULL, use_io_uring, &fds[1], 1);
+    }
+    else
+    {
+        if(sink->open != NULL && sink->open(&sink_state) < 0)
+            return -1;
+
+        for(int kind = 0; kind < SINK_DEVICE_COUNT; kind++)
+            handles[kind] = sink->create(&sink_state, kind, NULL, NULL);
+
+        data.pad_device = handles[SINK_DEVICE_PAD];
+        data.pen_device = handles[SINK_DEVICE_PEN];
+        data.mouse_device = handles[SINK_DEVICE_MOUSE];
+        data.keyboard_device = handles[SINK_DEVICE_KEYBOARD];
+        output_setup(&output, sink, &sink_state, use_io_uring, handles, SINK_DEVICE_COUNT);
+    }
+
+    data.state = &state;
+    data.output = &output;
+    data.plan = use_plan ? &plan : NULL;
+    data.mapping = &mapping;
+    data.filter = use_smoothing ? &filter : NULL;
+    data.predict = use_prediction ? &predict : NULL;
+    data.pressure = &pressure;
+
+    for(size_t pass = 0; pass < passes && !failed; pass++)
+    {
+        // Every pass starts against freshly created devices
+        state = (struct driver_state_t){};
+        for(size_t i = 0; i < output.file_count; i++)
+            output.shadows[i] = (struct frame_shadow_t){ .fd = output.files[i] };
+
+        for(size_t i = 0; i < file->count && !failed; i++)
+        {
+            report = &file->reports[i];
+            type = report_type(i);
+
+            data.data = report->data;
+            data.size = report->size;
+            data.timestamp = report->timestamp;
+
+            start = get_time_ns();
+            if((use_plan ? rdesc_process_raw_input(&data) : hs610_process_raw_input(&data)) < 0)
+            {
+                __ERROR("driver failed on report #%zu", i);
+                failed = true;
+                continue;
+            }
+            stats[type].decode_ns += get_time_ns() - start;
+            stats[type].reports++;
+
+            if(sink == NULL)
+                stats[type].events += drain_events(fds[0]);
+            else
+            {
+                stats[type].events += sink_events(&sink_state) - sink_seen;
+                sink_seen = sink_events(&sink_state);
+            }
+        }
+    }
+
+    // Anything still in flight counts towards whatever came last
+    output_drain(&output);
+    if(sink == NULL)
+    {
+        stats[type].events += drain_events(fds[0]);
+        close(fds[0]);
+        close(fds[1]);
+    }
+    else
+    {
+        if(dump_path != NULL && !failed && dump_events(dump_path) < 0)
+            failed = true;
+        if(sink->close != NULL)
+            sink->close(&sink_state);
+    }
+
+    if(failed)
+    {
+        output_close(&output);
+        return -1;
+    }
+
+    printf("report mix:     ");
+    for(type = 0; type < ANALYZE_TYPE_COUNT; type++)
+    {
+        printf(
+            "%s %zu (%.1f%%)%s", type_names[type], stats[type].reports / passes,
+            100.0 * stats[type].reports / (file->count * passes), type + 1 < ANALYZE_TYPE_COUNT ? ", " : "\n"
+        );
+
+        total_reports += stats[type].reports;
+        total_ns += stats[type].decode_ns;
+        total_events += stats[type].events;
+    }
+
+    printf(
+        "decode:         %.0f ns/report, %.2f events/report over %zu pass%s\n",
+        (double)total_ns / total_reports, (double)total_events / total_reports,
+        passes, passes > 1 ? "es" : ""
+    );
+    for(type = 0; type < ANALYZE_TYPE_COUNT; type++)
+    {
+        if(stats[type].reports == 0) continue;
+        printf(
+            "  %-14s%.0f ns/report, %.2f events/report\n", type_names[type],
+            (double)stats[type].decode_ns / stats[type].reports,
+            (double)stats[type].events / stats[type].reports
+        );
+    }
+
+    if(sink != NULL)
+    {
+        printf("output:         %s sink, %llu writes\n", sink->name, (unsigned long long)output.writes);
+        output_close(&output);
+        return 0;
+    }
+
+    printf(
+        "output:         %s, %llu writes, %.0f ns average, %.0f ns max to completion",
+        output.use_io_uring ? "io_uring" : "write", (unsigned long long)output.writes,
+        (double)output.latency_total / MAX(output.completions, 1), (double)output.latency_max
+    );
+    if(output.use_io_uring)
+        printf(", %.1f average, %u max in flight", (double)output.depth_total / MAX(output.writes, 1), output.depth_max);
+    printf("\n");
+
+    output_close(&output);
+    return 0;
+}
+
+static void print_errors(const char *label, uint64_t *errors, size_t count, double total)
+{
+    qsort(errors, count, sizeof(uint64_t), compare_u64);
+    printf(
+        "  %-14smean %.3f mm, p50 %.3f mm, p95 %.3f mm, max %.3f mm\n", label,
+        total / count / MODEL_RESOLUTION, (double)errors[count / 2] / MODEL_RESOLUTION,
+        (double)errors[MIN((size_t)(0.95 * (count - 1) + 0.5), count - 1)] / MODEL_RESOLUTION,
+        (double)errors[count - 1] / MODEL_RESOLUTION
+    );
+}
+
+// Runs the predictor over the capture and checks every guess against where
+// the pen really was lead ms later (between the two reports around that
+// time). Guesses whose answer falls past the end of the stroke, or past
+// touching down or lifting the pen, can't be checked and are left out
+static void analyze_prediction(const struct report_file_t *file, const struct predict_t *predict)
+{
+    int32_t x = 0, y = 0;
+    size_t count = 0, next = 0, last = 0;
+    uint64_t target = 0, *errors = NULL, *lags = NULL;
+    double actual_x = 0, actual_y = 0, part = 0, error_total = 0, lag_total = 0;
+    struct predict_state_t state = (struct predict_state_t){};
+    const struct report_t *before = NULL, *after = NULL;
+
+    if(!file->has_timestamps)
+    {
+        printf("prediction:     not available, the capture has no timestamps\n");
+        return;
+    }
+
+    errors = malloc(file->count * sizeof(uint64_t));
+    lags = malloc(file->count * sizeof(uint64_t));
+    if(errors == NULL || lags == NULL)
+    {
+        __ERROR("cannot allocate memory for %zu prediction errors", file->count);
+        free(errors);
+        free(lags);
+        return;
+    }
+
+    for(size_t i = 0; i < file->count; i++)
+    {
+        if(!pen_in_range(i))
+        {
+            predict_reset(&state);
+            continue;
+        }
+
+        x = batch.x[i];
+        y = batch.y[i];
+        predict_apply(predict, &state, file->reports[i].timestamp, (batch.flags[i] & MODEL_TOUCH) != 0,
+            mapping.max_x, mapping.max_y, &x, &y);
+
+        // First report at or past the time we predicted for, as long as the
+        // stroke lasts that long
+        target = file->reports[i].timestamp + predict->lead_us * 1000;
+        for(next = MAX(next, i + 1); next < file->count && pen_in_range(next) &&
+            (batch.flags[next] & MODEL_TOUCH) == (batch.flags[i] & MODEL_TOUCH) &&
+            file->reports[next].timestamp < target; next++);
+        if(next >= file->count || !pen_in_range(next) || (batch.flags[next] & MODEL_TOUCH) != (batch.flags[i] & MODEL_TOUCH))
+            continue;
+
+        last = next - 1;
+        before = &file->reports[last];
+        after = &file->reports[next];
+        part = after->timestamp > before->timestamp && target > before->timestamp ?
+            (double)(target - before->timestamp) / (after->timestamp - before->timestamp) : 1.0;
+        part = MIN(part, 1.0);
+        actual_x = batch.x[last] + (batch.x[next] - batch.x[last]) * part;
+        actual_y = batch.y[last] + (batch.y[next] - batch.y[last]) * part;
+
+        // How far off the guess was, against how far off not guessing at all
+        // would have been
+        errors[count] = (uint64_t)(hypot(x - actual_x, y - actual_y) + 0.5);
+        lags[count] = (uint64_t)(hypot(batch.x[i] - actual_x, batch.y[i] - actual_y) + 0.5);
+        error_total += hypot(x - actual_x, y - actual_y);
+        lag_total += hypot(batch.x[i] - actual_x, batch.y[i] - actual_y);
+        count++;
+    }
+
+    printf("prediction:     %.1f ms ahead, %zu reports checked\n", predict->lead_us / 1000.0, count);
+    if(count > 0)
+    {
+        print_errors("predicted", errors, count, error_total);
+        print_errors("not predicted", lags, count, lag_total);
+    }
+
+    free(errors);
+    free(lags);
+}
+
+// Decodes the capture with every batch engine this machine can run and
+// checks each one against plain C, field by field. Returns how many of
+// them got anything wrong
+static int check_batch_engines(const struct report_file_t *file)
+{
+    const char *engines[] = { "ssse3", "avx2" };
+    size_t mismatches = 0;
+    int failed = 0;
+    struct model_batch_t expected = (struct model_batch_t){}, actual = (struct model_batch_t){};
+
+    if(batch_alloc(&expected, file->count) < 0 || batch_alloc(&actual, file->count) < 0)
+    {
+        batch_free(&expected);
+        return -1;
+    }
+
+    hs610_select_batch_engine("scalar");
+    hs610_decode_batch(file->reports, file->count, &expected);
+
+    for(size_t engine = 0; engine < GET_LEN(engines); engine++)
+    {
+        if(hs610_select_batch_engine(engines[engine]) < 0)
+        {
+            printf("batch check:    %s not available here\n", engines[engine]);
+            continue;
+        }
+
+        // Whatever it leaves alone shows up as a mismatch
+        memset(actual.kinds, 0xa5, file->count * sizeof(uint8_t));
+        memset(actual.flags, 0xa5, file->count * sizeof(uint8_t));
+        memset(actual.x, 0xa5, file->count * sizeof(int32_t));
+        memset(actual.y, 0xa5, file->count * sizeof(int32_t));
+        memset(actual.pressure, 0xa5, file->count * sizeof(uint16_t));
+        memset(actual.tilt_x, 0xa5, file->count * sizeof(int16_t));
+        memset(actual.tilt_y, 0xa5, file->count * sizeof(int16_t));
+        memset(actual.buttons, 0xa5, file->count * sizeof(uint16_t));
+        memset(actual.dial, 0xa5, file->count * sizeof(uint8_t));
+        hs610_decode_batch(file->reports, file->count, &actual);
+
+        mismatches = 0;
+        for(size_t i = 0; i < file->count; i++)
+        {
+#define CHECK_FIELD(_field)                                                                 \
+            if(actual._field[i] != expected._field[i] && mismatches++ < ANALYZE_MAX_MISMATCHES) \
+                printf(                                                                     \
+                    "  %-14sreport #%zu " #_field " is %d, should be %d\n", engines[engine],   \
+                    i, (int)actual._field[i], (int)expected._field[i]                      \
+                )
+
+            CHECK_FIELD(kinds);
+            CHECK_FIELD(flags);
+            CHECK_FIELD(x);
+            CHECK_FIELD(y);
+            CHECK_FIELD(pressure);
+            CHECK_FIELD(tilt_x);
+            CHECK_FIELD(tilt_y);
+            CHECK_FIELD(buttons);
+            CHECK_FIELD(dial);
+#undef CHECK_FIELD
+        }
+
+        printf(
+            "batch check:    %s %s scalar over %zu reports", engines[engine],
+            mismatches == 0 ? "matches" : "doesn't match", file->count
+        );
+        if(mismatches > 0)
+            printf(", %zu values off", mismatches);
+        printf("\n");
+        failed += mismatches > 0;
+    }
+
+    hs610_select_batch_engine(NULL);
+    batch_free(&expected);
+    batch_free(&actual);
+    return failed;
+}
+
+static inline void print_help()
+{
+    printf(
+        "Usage: faketabletd-analyze [OPTION] FILE\n"
+        "Report rate, jitter and decode cost statistics for captured HS610 reports\n\n"
+
+        "Options\n"
+        "  -s SIZE\t\tSize of each report on raw captures (default: %d)\n"
+        "  -n PASSES\t\tHow many times to run the capture through the driver (default: 1)\n"
+        "  -u\t\t\tWrites the decoded events through io_uring instead of write\n"
+        "  -o SINK\t\tHands the decoded events to a null, memory or counting sink instead of a pipe\n"
+        "  -d FILE\t\tWrites the decoded events to FILE, one per line (uses the memory sink)\n"
+        "  -g\t\t\tDecodes through the Huion report descriptor instead of the HS610 driver\n"
+        "  -f\t\t\tSmooths the pen while decoding, with the default smoothing settings\n"
+        "  -p MS\t\t\tPredicts the pen MS ahead while decoding, and checks how far off that is\n"
+        "  -c\t\t\tOnly checks every batch decoder this machine can run against the plain C one\n"
+        "  -h\t\t\tShows this help\n",
+        REPORT_FILE_RAW_SIZE
+    );
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    uint64_t batch_ns = 0, smoothing_ns = 0;
+    bool use_io_uring = false, use_plan = false, use_smoothing = false, use_prediction = false, check_engines = false;
+    size_t smoothed = 0;
+    const struct sink_t *sink = NULL;
+    const char *dump_path = NULL;
+    const struct generic_pen_ranges_t *ranges = NULL;
+    size_t raw_report_size = REPORT_FILE_RAW_SIZE, passes = 1;
+    struct report_file_t file;
+
+    while((ret = getopt(argc, argv, "s:n:uo:d:gfp:ch")) != -1)
+    {
+        switch (ret)
+        {
+        case 's':
+            raw_report_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            passes = MAX(strtoul(optarg, NULL, 10), 1);
+            break;
+        case 'u':
+            use_io_uring = true;
+            break;
+        case 'o':
+            // There's no uinput to be had offline
+            if((sink = sink_find(optarg)) == NULL || sink->write == NULL)
+            {
+                __ERROR("invalid sink \"%s\"", optarg);
+                exit(1);
+            }
+            break;
+        case 'd':
+            dump_path = optarg;
+            break;
+        case 'g':
+            use_plan = true;
+            break;
+        case 'f':
+            use_smoothing = true;
+            break;
+        case 'p':
+            if(predict_setup(&predict, strtof(optarg, NULL)) < 0)
+                exit(1);
+            use_prediction = true;
+            break;
+        case 'c':
+            check_engines = true;
+            break;
+        case 'h':
+            print_help();
+            exit(0);
+            break;
+        default:
+            print_help();
+            exit(1);
+            break;
+        }
+    }
+
+    if(optind >= argc)
+    {
+        print_help();
+        exit(1);
+    }
+
+    // Only the memory sink keeps anything around to write
+    if(dump_path != NULL && sink != NULL && sink != &memory_sink)
+    {
+        __ERROR("-d only works with the memory sink");
+        exit(1);
+    }
+    if(dump_path != NULL)
+        sink = &memory_sink;
+
+    __CATCHER_CRITICAL(report_file_load(&file, argv[optind], raw_report_size), "cannot load \"%s\"", argv[optind]);
+
+    printf("capture:        %s (%s, %zu reports", argv[optind], report_file_format_name(file.format), file.count);
+    if(file.vendor_id != 0 || file.product_id != 0)
+        printf(", %04x:%04x", file.vendor_id, file.product_id);
+    printf(")\n");
+
+    if(file.count == 0)
+    {
+        report_file_free(&file);
+        return 0;
+    }
+
+    if(check_engines)
+    {
+        ret = check_batch_engines(&file);
+        report_file_free(&file);
+        return ret != 0 ? 1 : 0;
+    }
+
+    if(batch_alloc(&batch, file.count) < 0)
+    {
+        report_file_free(&file);
+        return 1;
+    }
+    batch_ns = analyze_batch(&file, passes);
+
+    if(file.has_timestamps && file.count > 1)
+        analyze_timing(&file);
+    else
+        printf("timing:         not available, the capture has no timestamps\n");
+
+    if(use_plan && hid_compile(&plan, huion_hid_profile.descriptor, huion_hid_profile.descriptor_size, huion_hid_profile.subreports) < 0)
+    {
+        batch_free(&batch);
+        report_file_free(&file);
+        return 1;
+    }
+
+    // The whole tablet, the way it sits by default
+    ranges = use_plan ? &generic_pen_ranges : &hs610_pen_ranges;
+    mapping_compute(&mapping, &(const struct mapping_options_t){}, ranges->max_x, ranges->max_y, DEFAULT_CURSOR_SPEED);
+
+    filter_setup(&filter, FILTER_DEFAULT_CUTOFF, FILTER_DEFAULT_BETA, FILTER_DEFAULT_PRESSURE_BETA);
+    smoothing_ns = analyze_smoothing(&file, passes, &filter, &smoothed);
+
+    ret = analyze_decode(&file, passes, sink, use_io_uring, use_plan, use_smoothing, use_prediction, dump_path);
+    if(ret == 0)
+        printf(
+            "batch decode:   %.2f ns/report (%s), %.1fM reports/s\n",
+            (double)batch_ns / (file.count * passes), hs610_batch_engine(),
+            batch_ns > 0 ? file.count * passes / (batch_ns / 1e3) : 0.0
+        );
+
+    if(ret == 0 && smoothed > 0)
+        printf("smoothing:      %.1f ns/report over %zu pen reports in range\n", (double)smoothing_ns / smoothed, smoothed / passes);
+    if(ret == 0 && use_prediction)
+        analyze_prediction(&file, &predict);
+
+    batch_free(&batch);
+    report_file_free(&file);
+    return ret < 0 ? 1 : 0;
+}
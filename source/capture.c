@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "capture.h"
+#include "utilities.h"
+
+static size_t capture_file_size(size_t records)
+{
+    return sizeof(struct capture_header_t) + records * sizeof(struct capture_record_t);
+}
+
+// Reserves room for CAPTURE_GROW_RECORDS more records and maps it. The new
+// pages get faulted in here, so the hot path never has to
+static int grow_file(struct capture_t *capture)
+{
+    int ret = 0;
+    uint8_t *map = NULL;
+    size_t capacity = capture->capacity + CAPTURE_GROW_RECORDS;
+    size_t size = capture_file_size(capacity);
+
+    // posix_fallocate makes sure the blocks are there, so a full disk
+    // doesn't turn into a SIGBUS later on
+    if((ret = posix_fallocate(capture->fd, 0, size)) != 0)
+    {
+        __WARNING("cannot extend capture file: %s", strerror(ret));
+        return -1;
+    }
+
+    if(capture->map == NULL)
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, capture->fd, 0);
+    else
+        map = mremap(capture->map, capture->map_size, size, MREMAP_MAYMOVE);
+
+    if(map == MAP_FAILED)
+    {
+        __WARNING("cannot map capture file: %s", strerror(errno));
+        return -1;
+    }
+
+#ifdef MADV_POPULATE_WRITE
+    if(capture->map != NULL)
+        madvise(map + capture->map_size, size - capture->map_size, MADV_POPULATE_WRITE);
+#endif
+
+    capture->map = map;
+    capture->map_size = size;
+    capture->header = (struct capture_header_t *)map;
+    capture->records = (struct capture_record_t *)(map + sizeof(struct capture_header_t));
+    capture->capacity = capacity;
+    return 0;
+}
+
+int capture_open(struct capture_t *capture, const char *path, uint16_t vendor_id, uint16_t product_id)
+{
+    *capture = (struct capture_t){ .fd = -1 };
+
+    if((capture->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0)
+    {
+        __ERROR("cannot create capture file \"%s\": %s", path, strerror(errno));
+        return -1;
+    }
+
+    if(grow_file(capture) < 0)
+    {
+        capture_close(capture);
+        return -1;
+    }
+
+    *capture->header = (struct capture_header_t){
+        .version = CAPTURE_VERSION,
+        .header_size = sizeof(struct capture_header_t),
+        .record_size = sizeof(struct capture_record_t),
+        .vendor_id = vendor_id,
+        .product_id = product_id,
+        .start_time = get_time_ns(),
+    };
+    memcpy(capture->header->magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE);
+
+    return 0;
+}
+
+void capture_grow(struct capture_t *capture)
+{
+    if(!capture_needs_room(capture))
+        return;
+
+    if(grow_file(capture) < 0)
+    {
+        __WARNING("capture file cannot grow, reports will be left out once it's full");
+        capture->failed = true;
+    }
+}
+
+void capture_write(struct capture_t *capture, uint64_t timestamp, uint8_t endpoint, const uint8_t *data, size_t size)
+{
+    uint64_t count = 0;
+    struct capture_record_t *record = NULL;
+
+    if(capture->map == NULL)
+        return;
+
+    // The file gets grown long before this, unless it can't be or whoever
+    // records didn't get around to it
+    count = capture->header->record_count;
+    if(count == capture->capacity)
+    {
+        if(capture->missed++ == 0)
+            __WARNING("capture file is full, leaving reports out");
+        return;
+    }
+
+    record = &capture->records[count];
+    record->timestamp = timestamp;
+    record->length = MIN(size, CAPTURE_PAYLOAD_SIZE);
+    record->endpoint = endpoint;
+    memcpy(record->payload, data, record->length);
+
+    // Only counted once it's all there, so a reader never sees half a record
+    capture->header->record_count = count + 1;
+}
+
+void capture_close(struct capture_t *capture)
+{
+    size_t size = 0;
+
+    if(capture->map != NULL)
+    {
+        size = capture_file_size(capture->header->record_count);
+        munmap(capture->map, capture->map_size);
+
+        // Give back whatever we reserved and didn't use
+        if(ftruncate(capture->fd, size) < 0)
+            __WARNING("cannot trim capture file: %s", strerror(errno));
+    }
+
+    if(capture->fd >= 0)
+        close(capture->fd);
+
+    *capture = (struct capture_t){ .fd = -1 };
+}
@@ -0,0 +1,107 @@
+#ifndef FAKETABLETD_CAPTURE_H__
+#define FAKETABLETD_CAPTURE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Capture file format (version 1)
+//
+// Everything is little endian. The file starts with a 64 byte header
+//
+//  offset  size  field
+//  0       8     magic, "FTDCAP\0\0"
+//  8       2     version, 1
+//  10      2     header size in bytes, 64
+//  12      2     record size in bytes, 80
+//  14      2     vendor id of the captured device
+//  16      2     product id of the captured device
+//  18      6     reserved, zero
+//  24      8     CLOCK_MONOTONIC time in ns when the capture started
+//  32      8     record count
+//  40      24    reserved, zero
+//
+// followed by record count fixed size records
+//
+//  offset  size  field
+//  0       8     CLOCK_MONOTONIC time in ns when the report arrived
+//  8       2     report length in bytes, at most 64
+//  10      1     endpoint the report came from
+//  11      5     reserved, zero
+//  16      64    report, zero padded
+//
+// The file is grown ahead of the writer, so it might be longer than the
+// records it holds. Readers should trust the record count, capped to what
+// actually fits in the file in case the writer never got to close it
+
+#define CAPTURE_MAGIC               "FTDCAP\0\0"
+#define CAPTURE_MAGIC_SIZE          8
+#define CAPTURE_VERSION             1
+#define CAPTURE_PAYLOAD_SIZE        64
+
+struct capture_header_t
+{
+    char magic[CAPTURE_MAGIC_SIZE];
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t record_size;
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint8_t reserved_0[6];
+    uint64_t start_time;
+    uint64_t record_count;
+    uint8_t reserved_1[24];
+} __attribute__((packed));
+
+struct capture_record_t
+{
+    uint64_t timestamp;
+    uint16_t length;
+    uint8_t endpoint;
+    uint8_t reserved[5];
+    uint8_t payload[CAPTURE_PAYLOAD_SIZE];
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct capture_header_t) == 64, "capture header must be 64 bytes long");
+_Static_assert(sizeof(struct capture_record_t) == 80, "capture records must be 80 bytes long");
+
+// How many records we grow the file by. It gets grown once it's down to
+// half of that, so there's still plenty of room while it does
+#define CAPTURE_GROW_RECORDS        16384
+
+// Writes reports straight into a shared mapping of the file, so recording
+// one is a copy into memory that is already there. Growing the file is up
+// to whoever records, at some point they aren't busy with a report.
+// failed is set once it couldn't grow, and missed counts the reports left
+// out because there was no room for them
+struct capture_t
+{
+    int fd;
+    bool failed;
+    uint64_t missed;
+
+    uint8_t *map;
+    size_t map_size;
+
+    struct capture_header_t *header;
+    struct capture_record_t *records;
+    size_t capacity;
+};
+
+int capture_open(struct capture_t *capture, const char *path, uint16_t vendor_id, uint16_t product_id);
+
+// Whether it's time to capture_grow
+static inline bool capture_needs_room(const struct capture_t *capture)
+{
+    return capture->map != NULL && !capture->failed &&
+        capture->capacity - capture->header->record_count <= CAPTURE_GROW_RECORDS / 2;
+}
+
+// Makes room for CAPTURE_GROW_RECORDS more reports, if it's needed. Might
+// move the mapping, so never while a report is being recorded
+void capture_grow(struct capture_t *capture);
+
+void capture_write(struct capture_t *capture, uint64_t timestamp, uint8_t endpoint, const uint8_t *data, size_t size);
+void capture_close(struct capture_t *capture);
+
+#endif
@@ -0,0 +1,678 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <limits.h>
+#include <poll.h>
+
+#include <sys/eventfd.h>
+#include <linux/uinput.h>
+
+#include "device.h"
+#include "utilities.h"
+#include "drivers/generic/generic.h"
+
+#define USE_RETURNING_CALLBACK(_cb, ...)                        \
+{                                                               \
+    VALIDATE(                                                   \
+        _cb != NULL,                                            \
+        "cannot call empty callback \"" #_cb "\""               \
+    );                                                          \
+    return _cb(__VA_ARGS__);                                    \
+}
+
+#define DESTROY_VIRTUAL_DEVICE(_ctx, _handle)                   \
+{                                                               \
+    if(_handle >= 0)                                            \
+    {                                                           \
+        (_ctx)->sink->destroy(&(_ctx)->sink_state, _handle);    \
+        _handle = -1;                                           \
+    }                                                           \
+}
+
+// Callback handlers
+static inline int process_raw_input(struct device_context_t *ctx, const struct raw_input_data_t *data)
+{ USE_RETURNING_CALLBACK(ctx->process_raw_input_callback, data); }
+
+// faketablet id
+static const struct input_id faketabletd_id = (const struct input_id)
+{
+    .bustype    = BUS_USB,
+    .vendor     = FAKETABLETD_VID,
+    .product    = FAKETABLETD_PID,
+    .version    = FAKETABLETD_VERSION,
+};
+static const struct input_id wacom_id = (const struct input_id)
+{
+    .bustype    = BUS_USB,
+    .vendor     = 0x056a,
+    .product    = 0x0314,
+    .version    = 0x0110,
+};
+
+// Pokes whoever is running the device's event loop, so it notices we are
+// closing even if the request came from another thread
+static void wake_event_thread(struct device_context_t *ctx)
+{
+    uint64_t value = 1;
+    int fd = ctx->threaded ? ctx->wake_fd : ctx->notify_fd;
+
+    if(fd >= 0 && write(fd, &value, sizeof(value)) < 0)
+        DEVICE_WARNING(ctx, "cannot wake event thread");
+}
+
+static void wake_translator(struct device_context_t *ctx)
+{
+    uint64_t value = 1;
+
+    if(ctx->translator_fd >= 0 && write(ctx->translator_fd, &value, sizeof(value)) < 0)
+        DEVICE_WARNING(ctx, "cannot wake translator thread");
+}
+
+static void stop_transport(struct device_context_t *ctx)
+{
+    if(ctx->transport == NULL || ctx->transport_stopped)
+        return;
+
+    ctx->transport->stop(ctx);
+    ctx->transport_stopped = true;
+}
+
+static void output_ready_callback(struct reactor_t *reactor, int fd, uint32_t events, void *user_data);
+
+// Has the reactor let us know once a virtual device with frames waiting for
+// it has room again, for as long as it has any. Edge triggered, since
+// uinput always says it's writable and we'd only spin on it otherwise. The
+// next write flushes them as well, so failing to watch isn't the end of it.
+// Frames waiting behind a write io_uring hasn't finished yet need the ring
+// instead, which is readable for as long as there's completions to pick up
+static void watch_output(struct device_context_t *ctx)
+{
+    uint32_t bit = 0;
+    bool ring_needed = (ctx->output.pending_files & ctx->output.busy_files) != 0;
+
+    for(size_t i = 0; i < ctx->output.file_count; i++)
+    {
+        bit = 1u << i;
+        if((ctx->output.pending_files & bit) && !(ctx->output_watched & bit))
+        {
+            if(reactor_add_fd(ctx->reactor, ctx->output.files[i], EPOLLOUT | EPOLLET, output_ready_callback, ctx) == 0)
+                ctx->output_watched |= bit;
+        }
+        else if(!(ctx->output.pending_files & bit) && (ctx->output_watched & bit))
+        {
+            reactor_remove_fd(ctx->reactor, ctx->output.files[i]);
+            ctx->output_watched &= ~bit;
+        }
+    }
+
+    if(ring_needed && !(ctx->output_watched & OUTPUT_WATCHED_RING))
+    {
+        if(reactor_add_fd(ctx->reactor, ctx->output.ring_fd, EPOLLIN, output_ready_callback, ctx) == 0)
+            ctx->output_watched |= OUTPUT_WATCHED_RING;
+    }
+    else if(!ring_needed && (ctx->output_watched & OUTPUT_WATCHED_RING))
+    {
+        reactor_remove_fd(ctx->reactor, ctx->output.ring_fd);
+        ctx->output_watched &= ~OUTPUT_WATCHED_RING;
+    }
+}
+
+static void unwatch_output(struct device_context_t *ctx)
+{
+    for(size_t i = 0; i < ctx->output.file_count; i++)
+        if(ctx->output_watched & (1u << i))
+            reactor_remove_fd(ctx->reactor, ctx->output.files[i]);
+    if(ctx->output_watched & OUTPUT_WATCHED_RING)
+        reactor_remove_fd(ctx->reactor, ctx->output.ring_fd);
+    ctx->output_watched = 0;
+}
+
+static void output_ready_callback(struct reactor_t *reactor, int fd, uint32_t events, void *user_data)
+{
+    struct device_context_t *ctx = (struct device_context_t *)user_data;
+
+    output_flush(&ctx->output);
+    watch_output(ctx);
+}
+
+// Hands a single report over to the driver
+static int deliver_report(struct device_context_t *ctx, const uint8_t *data, size_t size, uint64_t timestamp)
+{
+    int ret = 0;
+    struct raw_input_data_t raw_input_data = (struct raw_input_data_t){
+        .data = data,
+        .size = size,
+        .timestamp = timestamp,
+
+        .state = &ctx->driver_state,
+
+        .pad_device = ctx->pad_device,
+        .pen_device = ctx->pen_device,
+
+        .mouse_device = ctx->mouse_device,
+        .keyboard_device = ctx->keyboard_device,
+
+        .use_virtual_cursor = ctx->options->use_virtual_cursor,
+        .use_virtual_wheel = ctx->options->use_virtual_wheel,
+
+        .config_available = ctx->options->config_available,
+
+        .output = &ctx->output,
+        .plan = ctx->hid_profile != NULL ? &ctx->hid_plan : NULL,
+        .mapping = &ctx->mapping,
+        .filter = ctx->options->use_smoothing ? &ctx->options->filter : NULL,
+        .predict = ctx->options->use_prediction ? &ctx->options->predict : NULL,
+        .pressure = &ctx->options->pressure
+    };
+
+    ctx->output.decoded_at = ctx->output.emitted_at = 0;
+    if((ret = process_raw_input(ctx, &raw_input_data)) < 0)
+        return ret;
+
+    // The translator thread waits on the virtual devices itself
+    if(!ctx->options->use_pipeline && (ctx->output.pending_files | ctx->output_watched) != 0)
+        watch_output(ctx);
+
+    // Reports the driver had nothing to say about don't count. Replays going
+    // faster than they were captured stamp reports ahead of the clock, and
+    // those say nothing about how long they took to get here
+    if(ctx->output.decoded_at != 0 && ctx->output.decoded_at >= timestamp)
+        histogram_record(&ctx->usb_to_decode, ctx->output.decoded_at - timestamp);
+    if(ctx->output.emitted_at != 0)
+    {
+        histogram_record(&ctx->decode_to_emit, ctx->output.emitted_at - ctx->output.decoded_at);
+        if(ctx->output.emitted_at >= timestamp)
+            histogram_record(&ctx->usb_to_emit, ctx->output.emitted_at - timestamp);
+    }
+
+    return 0;
+}
+
+// Sleeps until there's another report, or until a virtual device with
+// frames waiting for it has room for them
+static int wait_translator(struct device_context_t *ctx)
+{
+    uint64_t value = 0;
+    size_t count = 0;
+    struct pollfd fds[OUTPUT_MAX_FILES + 2];
+
+    if(ctx->output.pending_files == 0)
+        return read(ctx->translator_fd, &value, sizeof(value)) < 0 && errno != EINTR ? -1 : 0;
+
+    // Devices with a write still on its way are writable all along, it's
+    // the ring that says when they're done
+    fds[count++] = (struct pollfd){ .fd = ctx->translator_fd, .events = POLLIN };
+    for(size_t i = 0; i < ctx->output.file_count; i++)
+        if(ctx->output.pending_files & ~ctx->output.busy_files & (1u << i))
+            fds[count++] = (struct pollfd){ .fd = ctx->output.files[i], .events = POLLOUT };
+    if(ctx->output.pending_files & ctx->output.busy_files)
+        fds[count++] = (struct pollfd){ .fd = ctx->output.ring_fd, .events = POLLIN };
+
+    if(poll(fds, count, -1) < 0)
+        return errno != EINTR ? -1 : 0;
+
+    output_flush(&ctx->output);
+    if((fds[0].revents & POLLIN) && read(ctx->translator_fd, &value, sizeof(value)) < 0 && errno != EINTR)
+        return -1;
+    return 0;
+}
+
+// Second stage of the pipeline. Drains the ring into the driver and sleeps
+// on translator_fd whenever there's nothing left
+static void *translator_thread(void *user_data)
+{
+    const struct report_t *report = NULL;
+    struct device_context_t *ctx = (struct device_context_t *)user_data;
+
+    realtime_setup_thread(&ctx->options->realtime, "translator thread");
+
+    while(!atomic_load(&ctx->closing))
+    {
+        while((report = report_ring_peek(&ctx->ring)) != NULL)
+        {
+            if(deliver_report(ctx, report->data, report->size, report->timestamp) < 0)
+            {
+                atomic_store(&ctx->closing, true);
+                wake_event_thread(ctx);
+                return NULL;
+            }
+            report_ring_pop(&ctx->ring);
+        }
+
+        // Let the producer know it has to wake us up, then make sure nothing
+        // slipped in before it could see that
+        atomic_store(&ctx->ring.consumer_waiting, true);
+        if(report_ring_peek(&ctx->ring) != NULL || atomic_load(&ctx->closing))
+        {
+            atomic_store(&ctx->ring.consumer_waiting, false);
+            continue;
+        }
+
+        if(wait_translator(ctx) < 0)
+            break;
+        atomic_store(&ctx->ring.consumer_waiting, false);
+    }
+
+    return NULL;
+}
+
+static void capture_timer_callback(struct reactor_t *reactor, uint64_t expirations, void *user_data)
+{
+    struct device_context_t *ctx = (struct device_context_t *)user_data;
+
+    ctx->capture_grow_scheduled = false;
+    capture_grow(&ctx->capture);
+}
+
+// Has the capture file grow once the reactor is done with whatever it's
+// handling now, rather than in the middle of a report
+static void schedule_capture_grow(struct device_context_t *ctx)
+{
+    if(ctx->capture_grow_scheduled || ctx->reactor == NULL)
+        return;
+
+    if(ctx->capture_timer < 0)
+        ctx->capture_timer = reactor_add_timer(ctx->reactor, 0, 0, capture_timer_callback, ctx);
+    else if(reactor_set_timer(ctx->reactor, ctx->capture_timer, 0, 0) < 0)
+        return;
+
+    ctx->capture_grow_scheduled = ctx->capture_timer >= 0;
+}
+
+static void remove_capture_timer(struct device_context_t *ctx)
+{
+    if(ctx->capture_timer >= 0 && ctx->reactor != NULL)
+        reactor_remove_fd(ctx->reactor, ctx->capture_timer);
+    ctx->capture_timer = -1;
+    ctx->capture_grow_scheduled = false;
+}
+
+// Takes a report fresh off the device. With the pipeline on, all we do here
+// is copy it out so the device can go on with the next one. A full ring
+// drops the report (and counts it) rather than holding the endpoint up
+int device_deliver_report(struct device_context_t *ctx, const uint8_t *data, size_t size, uint64_t timestamp)
+{
+    capture_write(&ctx->capture, timestamp, HID_ENDPOINT, data, size);
+    if(capture_needs_room(&ctx->capture))
+        schedule_capture_grow(ctx);
+
+    if(!ctx->options->use_pipeline)
+        return deliver_report(ctx, data, size, timestamp);
+
+    if(report_ring_push(&ctx->ring, data, size, timestamp) &&
+        atomic_exchange(&ctx->ring.consumer_waiting, false))
+        wake_translator(ctx);
+    return 0;
+}
+
+static void wake_callback(struct reactor_t *reactor, int fd, uint32_t events, void *user_data)
+{
+    uint64_t value = 0;
+    if(read(fd, &value, sizeof(value)) < 0) return;
+}
+
+static void *device_thread(void *user_data)
+{
+    int ret = 0, cpu = 0;
+    uint64_t value = 1;
+    cpu_set_t cpus;
+    struct device_context_t *ctx = (struct device_context_t *)user_data;
+    const struct device_options_t *options = ctx->options;
+
+    // -p still decides which cpu each worker ends up on
+    realtime_setup_thread(&options->realtime, "device thread");
+
+    if(options->thread_cpu_count > 0)
+    {
+        cpu = options->thread_cpus[ctx->index % options->thread_cpu_count];
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if((ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) != 0)
+            DEVICE_WARNING(ctx, "cannot pin thread to cpu %d: %s", cpu, strerror(ret));
+        else
+            DEVICE_INFO(ctx, "running on cpu %d", cpu);
+    }
+
+    do
+    {
+        if(reactor_init(&ctx->thread_reactor) < 0) break;
+        ctx->reactor = &ctx->thread_reactor;
+
+        if(ctx->usb_context != NULL && reactor_attach_usb(ctx->reactor, ctx->usb_context) < 0) break;
+        if(reactor_add_fd(ctx->reactor, ctx->wake_fd, EPOLLIN, wake_callback, ctx) < 0) break;
+        if(options->realtime.probe && latency_probe_start(&ctx->latency_probe, ctx->reactor) < 0) break;
+        if(ctx->transport->start(ctx) < 0) break;
+
+        while(!atomic_load(&ctx->closing))
+            if(reactor_run_once(ctx->reactor, -1) < 0) break;
+    } while(0);
+
+    // Wait for whatever the transport still has on its way back
+    stop_transport(ctx);
+    while(ctx->reactor != NULL && !ctx->transport->is_stopped(ctx) && reactor_run_once(ctx->reactor, HID_TIMEOUT) > 0);
+
+    if(options->realtime.probe)
+        latency_probe_print(&ctx->latency_probe, "device thread");
+
+    unwatch_output(ctx);
+    remove_capture_timer(ctx);
+    reactor_destroy(&ctx->thread_reactor);
+    ctx->reactor = NULL;
+
+    atomic_store(&ctx->closing, true);
+    atomic_store(&ctx->finished, true);
+    if(write(ctx->notify_fd, &value, sizeof(value)) < 0)
+        DEVICE_WARNING(ctx, "cannot notify main thread");
+
+    return NULL;
+}
+
+// Builds the driver's plan, from the profile's own descriptor if it has one
+// or whatever the device hands us otherwise
+static int compile_report_plan(struct device_context_t *ctx)
+{
+    int size = 0;
+    uint8_t descriptor[HID_DESCRIPTOR_MAX_SIZE];
+    const struct hid_profile_t *profile = ctx->hid_profile;
+
+    if(profile->descriptor != NULL)
+    {
+        if(hid_compile(&ctx->hid_plan, profile->descriptor, profile->descriptor_size, profile->subreports) < 0)
+            return -1;
+    }
+    else
+    {
+        if(ctx->transport->get_report_descriptor == NULL)
+        {
+            DEVICE_WARNING(ctx, "cannot get a report descriptor through %s", ctx->transport->name);
+            return -1;
+        }
+
+        if((size = ctx->transport->get_report_descriptor(ctx, descriptor, sizeof(descriptor))) < 0)
+            return -1;
+        DEVICE_INFO(ctx, "got a %d byte report descriptor", size);
+
+        if(hid_compile(&ctx->hid_plan, descriptor, size, profile->subreports) < 0)
+        {
+            DEVICE_WARNING(ctx, "cannot build a report plan from the device's descriptor");
+            return -1;
+        }
+    }
+
+    hid_print_plan(&ctx->hid_plan, ctx->name);
+    return 0;
+}
+
+int device_open(struct device_context_t *ctx, struct libusb_device *device, const struct device_options_t *options, struct reactor_t *reactor, int notify_fd)
+{
+    int ret = 0;
+    struct input_id *input_id = NULL;
+
+    ctx->options = options;
+    ctx->notify_fd = notify_fd;
+    ctx->threaded = options->use_threads;
+    ctx->transfer_count = options->transfer_count;
+    ctx->bus_number = device != NULL ? libusb_get_bus_number(device) : 0;
+    ctx->device_address = device != NULL ? libusb_get_device_address(device) : 0;
+    ctx->transport = NULL;
+    ctx->transport_stopped = false;
+    ctx->sink = options->sink != NULL ? options->sink : &uinput_sink;
+    ctx->sink_state = (struct sink_state_t){};
+    ctx->pen_device = ctx->pad_device = ctx->mouse_device = ctx->keyboard_device = -1;
+    ctx->wake_fd = -1;
+    ctx->thread_started = false;
+    ctx->latency_probe = (struct latency_probe_t){ .timer = -1 };
+    ctx->translator_fd = -1;
+    ctx->translator_started = false;
+    ctx->hidraw_fd = -1;
+    ctx->replay_timer = -1;
+    ctx->capture = (struct capture_t){ .fd = -1 };
+    ctx->capture_timer = -1;
+    ctx->capture_grow_scheduled = false;
+    output_init(&ctx->output);
+    ctx->output_watched = 0;
+    histogram_reset(&ctx->usb_to_decode);
+    histogram_reset(&ctx->decode_to_emit);
+    histogram_reset(&ctx->usb_to_emit);
+    report_ring_init(&ctx->ring);
+    ctx->interface_0 = (struct interface_status_t){ .number = 0 };
+    ctx->interface_1 = (struct interface_status_t){ .number = 1 };
+    ctx->driver_state = (struct driver_state_t){};
+    atomic_store(&ctx->closing, false);
+    atomic_store(&ctx->finished, false);
+
+    if(options->replay_path != NULL)
+        ctx->transport = &replay_transport;
+    else if(options->use_hidraw)
+        ctx->transport = &hidraw_transport;
+    else
+        ctx->transport = &usb_transport;
+
+    if(!ctx->threaded)
+        ctx->reactor = reactor;
+
+    if((ret = ctx->transport->open(ctx, device)) < 0)
+        return ret;
+
+    if(ctx->hid_profile != NULL && compile_report_plan(ctx) < 0)
+        return -1;
+
+    if(mapping_compute(&ctx->mapping, &options->mapping, ctx->pen_ranges->max_x, ctx->pen_ranges->max_y, options->cursor_speed) < 0)
+        return -1;
+
+    if(options->capture_path != NULL)
+    {
+        char path[PATH_MAX] = {0};
+
+        if(ctx->index == 0)
+            snprintf(path, sizeof(path), "%s", options->capture_path);
+        else
+            snprintf(path, sizeof(path), "%s.%d", options->capture_path, ctx->index);
+
+        if(capture_open(&ctx->capture, path, ctx->descriptor.idVendor, ctx->descriptor.idProduct) < 0)
+            return -1;
+        DEVICE_INFO(ctx, "capturing reports to \"%s\"", path);
+    }
+
+    // Create virtual pen and pad
+    if(options->use_wacom)
+        input_id = (struct input_id *)&wacom_id;
+    else
+        input_id = (struct input_id *)&faketabletd_id;
+
+    ctx->sink_state.create_virtual_pad = ctx->create_virtual_pad_callback;
+    ctx->sink_state.create_virtual_pen = ctx->create_virtual_pen_callback;
+    if(ctx->sink->open != NULL && ctx->sink->open(&ctx->sink_state) < 0)
+        return -1;
+
+    ctx->pad_device = ctx->sink->create(&ctx->sink_state, SINK_DEVICE_PAD, input_id, FAKETABLETD_NAME " Pad");
+    ctx->pen_device = ctx->sink->create(&ctx->sink_state, SINK_DEVICE_PEN, input_id, FAKETABLETD_NAME " Pen");
+
+    if(options->use_virtual_mouse)
+        ctx->mouse_device = ctx->sink->create(&ctx->sink_state, SINK_DEVICE_MOUSE, NULL, NULL);
+    if(options->use_virtual_keyboard)
+        ctx->keyboard_device = ctx->sink->create(&ctx->sink_state, SINK_DEVICE_KEYBOARD, NULL, NULL);
+
+    {
+        int fds[] = { ctx->pen_device, ctx->pad_device, ctx->mouse_device, ctx->keyboard_device };
+
+        output_setup(&ctx->output, ctx->sink, &ctx->sink_state, options->use_io_uring, fds, GET_LEN(fds));
+        if(ctx->output.use_io_uring)
+            DEVICE_INFO(ctx, "writing events through io_uring");
+    }
+
+    if(options->use_pipeline)
+    {
+        __STD_CATCHER(ctx->translator_fd = eventfd(0, EFD_CLOEXEC), "cannot create translator event");
+        if(ctx->translator_fd < 0)
+            return -1;
+
+        if((ret = pthread_create(&ctx->translator_thread, NULL, translator_thread, ctx)) != 0)
+        {
+            DEVICE_WARNING(ctx, "cannot create translator thread: %s", strerror(ret));
+            return -1;
+        }
+        ctx->translator_started = true;
+    }
+
+    if(ctx->threaded)
+    {
+        __STD_CATCHER(ctx->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "cannot create wake up event");
+        if(ctx->wake_fd < 0)
+            return -1;
+
+        // The worker starts reading itself, so reports are handled over there
+        if((ret = pthread_create(&ctx->thread, NULL, device_thread, ctx)) != 0)
+        {
+            DEVICE_WARNING(ctx, "cannot create device thread: %s", strerror(ret));
+            return -1;
+        }
+        ctx->thread_started = true;
+    }
+    else if((ret = ctx->transport->start(ctx)) < 0)
+    {
+        // Whatever it did get going has to come back before device_close
+        // can free it, same as in the device thread
+        stop_transport(ctx);
+        while(!ctx->transport->is_stopped(ctx) && reactor_run_once(ctx->reactor, HID_TIMEOUT) > 0);
+        return ret;
+    }
+
+    DEVICE_INFO(ctx, "done configuring device!");
+    return 0;
+}
+
+void device_request_close(struct device_context_t *ctx)
+{
+    atomic_store(&ctx->closing, true);
+    wake_translator(ctx);
+
+    if(ctx->threaded)
+        wake_event_thread(ctx);
+    else
+        stop_transport(ctx);
+}
+
+static void print_latency(struct device_context_t *ctx, const struct histogram_t *histogram, const char *name)
+{
+    if(histogram->count == 0)
+        return;
+
+    DEVICE_INFO(
+        ctx, "%s: p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us over %llu reports", name,
+        histogram_percentile(histogram, 50) / 1e3, histogram_percentile(histogram, 99) / 1e3,
+        histogram_percentile(histogram, 99.9) / 1e3, histogram->max / 1e3,
+        (unsigned long long)histogram->count
+    );
+}
+
+void device_print_stats(struct device_context_t *ctx)
+{
+    if(ctx->transport != NULL && ctx->transport->print_stats != NULL)
+        ctx->transport->print_stats(ctx);
+
+    if(ctx->options != NULL && ctx->options->use_pipeline)
+    {
+        DEVICE_INFO(
+            ctx, "report ring: %zu reports, %zu overflows, %zu/%d queued now, %zu at most",
+            ctx->ring.pushed, ctx->ring.overflows, report_ring_occupancy(&ctx->ring),
+            REPORT_RING_SIZE, ctx->ring.high_watermark
+        );
+    }
+
+    output_print_stats(&ctx->output, ctx->name);
+    if(ctx->sink != NULL && ctx->sink->print_stats != NULL)
+        ctx->sink->print_stats(&ctx->sink_state, ctx->name);
+
+    print_latency(ctx, &ctx->usb_to_decode, "usb to decode");
+    print_latency(ctx, &ctx->decode_to_emit, "decode to emit");
+    print_latency(ctx, &ctx->usb_to_emit, "usb to emit");
+}
+
+bool device_is_finished(struct device_context_t *ctx)
+{
+    if(ctx->threaded)
+        return atomic_load(&ctx->finished);
+
+    if(!atomic_load(&ctx->closing))
+        return false;
+
+    // The transports only mark us as closing, whatever they have in flight
+    // still needs to be taken back
+    stop_transport(ctx);
+    return ctx->transport == NULL || ctx->transport->is_stopped(ctx);
+}
+
+// Free allocated objects
+void device_close(struct device_context_t *ctx)
+{
+    if(ctx->thread_started)
+    {
+        device_request_close(ctx);
+        pthread_join(ctx->thread, NULL);
+        ctx->thread_started = false;
+    }
+
+    if(ctx->translator_started)
+    {
+        atomic_store(&ctx->closing, true);
+        wake_translator(ctx);
+        pthread_join(ctx->translator_thread, NULL);
+        ctx->translator_started = false;
+    }
+
+    if(ctx->wake_fd >= 0)
+    {
+        close(ctx->wake_fd);
+        ctx->wake_fd = -1;
+    }
+
+    if(ctx->translator_fd >= 0)
+    {
+        close(ctx->translator_fd);
+        ctx->translator_fd = -1;
+    }
+
+    // Nobody is writing anymore, but something might still be on its way
+    if(ctx->output_watched != 0)
+        unwatch_output(ctx);
+    remove_capture_timer(ctx);
+    output_drain(&ctx->output);
+
+    if(ctx->options != NULL)
+        device_print_stats(ctx);
+    output_close(&ctx->output);
+
+    if(ctx->sink != NULL)
+    {
+        DESTROY_VIRTUAL_DEVICE(ctx, ctx->keyboard_device);
+        DESTROY_VIRTUAL_DEVICE(ctx, ctx->mouse_device);
+        DESTROY_VIRTUAL_DEVICE(ctx, ctx->pen_device);
+        DESTROY_VIRTUAL_DEVICE(ctx, ctx->pad_device);
+
+        if(ctx->sink->close != NULL)
+            ctx->sink->close(&ctx->sink_state);
+    }
+
+    if(ctx->transport != NULL)
+        ctx->transport->close(ctx);
+    ctx->transport = NULL;
+
+    if(ctx->capture.map != NULL)
+    {
+        DEVICE_INFO(
+            ctx, "captured %llu reports, %llu left out", (unsigned long long)ctx->capture.header->record_count,
+            (unsigned long long)ctx->capture.missed
+        );
+    }
+    capture_close(&ctx->capture);
+
+    ctx->reactor = NULL;
+    ctx->create_virtual_pad_callback = NULL;
+    ctx->create_virtual_pen_callback = NULL;
+    ctx->process_raw_input_callback = NULL;
+    ctx->in_use = false;
+}
@@ -0,0 +1,245 @@
+#ifndef FAKETABLETD_DEVICE_H__
+#define FAKETABLETD_DEVICE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include <libusb-1.0/libusb.h>
+
+#include "faketabletd.h"
+#include "reactor.h"
+#include "ring.h"
+#include "realtime.h"
+#include "reportfile.h"
+#include "transport.h"
+#include "capture.h"
+#include "output.h"
+#include "histogram.h"
+#include "sink.h"
+#include "hid.h"
+#include "mapping.h"
+
+#define FAKETABLETD_MAX_DEVICES     4
+#define FAKETABLETD_MAX_CPUS        16
+
+// output_watched bit for the io_uring ring, past the ones for the files
+#define OUTPUT_WATCHED_RING         (1u << OUTPUT_MAX_FILES)
+
+#define DEVICE_INFO(_ctx, _fmt, _args...)       __INFO("[%s #%d] " _fmt, (_ctx)->name, (_ctx)->index, ##_args)
+#define DEVICE_WARNING(_ctx, _fmt, _args...)    __WARNING("[%s #%d] " _fmt, (_ctx)->name, (_ctx)->index, ##_args)
+
+// Settings shared by every device we serve
+struct device_options_t
+{
+    bool use_wacom;
+    bool use_virtual_mouse;
+    bool use_virtual_keyboard;
+    bool use_virtual_cursor;
+    bool use_virtual_wheel;
+    bool config_available;
+
+    int cursor_speed;
+    size_t transfer_count;
+
+    // Hand reports over to a translator thread through a ring instead of
+    // translating them from the USB callback
+    bool use_pipeline;
+
+    // Read reports from the kernel's hidraw node instead of claiming the
+    // interfaces through libusb
+    bool use_hidraw;
+
+    // Play reports back from a capture instead of reading them from a
+    // device, spaced like they were captured if replay_timing is set
+    const char *replay_path;
+    bool replay_timing;
+    size_t replay_report_size;
+
+    // Record every report to this file (with the device index appended
+    // for any device but the first)
+    const char *capture_path;
+
+    // Write events to the virtual devices through io_uring
+    bool use_io_uring;
+
+    // What the virtual devices are. Defaults to uinput_sink when NULL
+    const struct sink_t *sink;
+
+    // Active area and rotation, the same for every tablet
+    struct mapping_options_t mapping;
+
+    // Smooths the pen's position and pressure before they go out
+    bool use_smoothing;
+    struct filter_t filter;
+
+    // Sends where the pen should be a few ms from now instead of where it is
+    bool use_prediction;
+    struct predict_t predict;
+
+    // Pressure curve, swapped whenever the config file is read again
+    struct pressure_t pressure;
+
+    // Service each device from its own thread, optionally pinned to
+    // thread_cpus[device index % thread_cpu_count]
+    bool use_threads;
+    int thread_cpus[FAKETABLETD_MAX_CPUS];
+    size_t thread_cpu_count;
+
+    // Scheduling policy for every thread on the hot path
+    struct realtime_options_t realtime;
+};
+
+struct interface_status_t
+{
+    int number;
+    bool claimed;
+    bool detached_from_kernel;
+};
+
+// Everything we need to serve a single tablet
+struct device_context_t
+{
+    bool in_use;
+    int index;
+
+    const char *name;
+    struct libusb_device_descriptor descriptor;
+    uint8_t bus_number;
+    uint8_t device_address;
+    uint64_t arrival_time;
+
+    const struct device_options_t *options;
+
+    // Where reports come from. transport_stopped is set once stop has been
+    // called on it
+    const struct transport_t *transport;
+    bool transport_stopped;
+
+    // Device setup callbacks
+    create_virtual_device_callback_t create_virtual_pad_callback;
+    create_virtual_device_callback_t create_virtual_pen_callback;
+
+    // Parsing callbacks
+    process_raw_input_callback_t process_raw_input_callback;
+
+    // Drivers decoding through the report descriptor get hid_plan built
+    // from it when the device is opened
+    const struct hid_profile_t *hid_profile;
+    struct hid_plan_t hid_plan;
+
+    // What the virtual pen reports in, and the transform from tablet
+    // coordinates onto it worked out from options->mapping on open
+    const struct generic_pen_ranges_t *pen_ranges;
+    struct mapping_t mapping;
+
+    // Only set when the device has a context of its own (threaded mode),
+    // otherwise it lives on the caller's
+    struct libusb_context *usb_context;
+    struct libusb_device *device;
+    struct libusb_device_handle *handle;
+    struct interface_status_t interface_0, interface_1;
+
+    // Interrupt transfer ring. transfers_in_flight is only touched from
+    // the thread handling this device's events, transfer_queue_starved counts
+    // how many times a report completed with no other transfer left queued
+    // on the endpoint
+    struct libusb_transfer *transfers[HID_MAX_TRANSFERS];
+    uint8_t *transfer_buffers[HID_MAX_TRANSFERS];
+    size_t transfer_count;
+    size_t transfers_in_flight;
+    size_t transfer_queue_starved;
+
+    // Transfer buffers either live in usbfs memory mapped by libusb_dev_mem_alloc
+    // (so the kernel can DMA straight into them), or in transfer_pool when
+    // that isn't available. Either way nothing is allocated on reconnect
+    uint8_t *transfer_dev_mem;
+    size_t transfer_dev_mem_size;
+    size_t transfer_buffer_size;
+
+    // hidraw transport. Nonblocking, drained from the reactor
+    int hidraw_fd;
+
+    // Replay transport. Reports go out from replay_timer, either in batches
+    // or when their time comes
+    struct report_file_t replay_file;
+    size_t replay_position;
+    uint64_t replay_start;
+    int replay_timer;
+
+    // Raw report capture, written from the thread servicing the device.
+    // capture_timer has it grow from the same reactor, in between reports
+    struct capture_t capture;
+    int capture_timer;
+    bool capture_grow_scheduled;
+
+    // Virtual devices, as handed out by sink
+    const struct sink_t *sink;
+    struct sink_state_t sink_state;
+    int pen_device, pad_device, mouse_device, keyboard_device;
+
+    // Whatever thread runs the driver writes to the virtual devices through
+    // here. output_watched has a bit for each of output's files the reactor
+    // is waiting on to have room, and OUTPUT_WATCHED_RING if it's waiting on
+    // io_uring too
+    struct output_t output;
+    uint32_t output_watched;
+
+    // Time from a report coming in to the driver being done with it, from
+    // there to its events being written, and the whole way through. Only
+    // touched by whoever runs the driver
+    struct histogram_t usb_to_decode;
+    struct histogram_t decode_to_emit;
+    struct histogram_t usb_to_emit;
+
+    // Whatever the driver needs to remember between reports
+    struct driver_state_t driver_state;
+
+    // The reactor servicing this device. Points to thread_reactor in
+    // threaded mode
+    struct reactor_t *reactor;
+    struct reactor_t thread_reactor;
+    pthread_t thread;
+    bool threaded;
+    bool thread_started;
+    struct latency_probe_t latency_probe;
+
+    // wake_fd lets the main thread poke the worker, notify_fd is written
+    // by the worker once it's done with the device
+    int wake_fd;
+    int notify_fd;
+
+    atomic_bool closing;
+    atomic_bool finished;
+
+    // Two stage pipeline. The USB side pushes reports into ring and the
+    // translator thread feeds them to the driver. translator_fd is a
+    // blocking eventfd the translator sleeps on
+    pthread_t translator_thread;
+    bool translator_started;
+    int translator_fd;
+    struct report_ring_t ring;
+
+    uint8_t transfer_pool[HID_MAX_TRANSFERS][HID_MAX_PACKET_SIZE] __attribute__((aligned(64)));
+};
+
+// Opens the device, creates the virtual devices and starts reading reports,
+// either on reactor or on a thread of its own if options->use_threads is set.
+// notify_fd is written once a threaded device is done. device is NULL when
+// replaying a capture
+int device_open(struct device_context_t *ctx, struct libusb_device *device, const struct device_options_t *options, struct reactor_t *reactor, int notify_fd);
+
+// Asks the device to stop. It's done once device_is_finished returns true,
+// after which device_close releases everything
+void device_request_close(struct device_context_t *ctx);
+bool device_is_finished(struct device_context_t *ctx);
+void device_close(struct device_context_t *ctx);
+
+void device_print_stats(struct device_context_t *ctx);
+
+// Called by the transports with every report they get, from the thread
+// servicing the device
+int device_deliver_report(struct device_context_t *ctx, const uint8_t *data, size_t size, uint64_t timestamp);
+
+#endif
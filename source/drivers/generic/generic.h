@@ -11,7 +11,30 @@
 #include "utilities.h"
 #include "faketabletd.h"
 
+// Ranges the generic virtual pen reports in
+#define GENERIC_PEN_MAX_X           50800
+#define GENERIC_PEN_MAX_Y           31750
+#define GENERIC_PEN_MAX_PRESSURE    8191
+#define GENERIC_PEN_MAX_TILT        60
+#define GENERIC_PEN_RESOLUTION      200
+
+// What the virtual pen reports, tilt going from -max_tilt to max_tilt
+struct generic_pen_ranges_t
+{
+    int32_t max_x;
+    int32_t max_y;
+    int32_t max_pressure;
+    int32_t max_tilt;
+    int32_t resolution;
+};
+
+// The GENERIC_PEN_* ones
+extern const struct generic_pen_ranges_t generic_pen_ranges;
+
 int generic_create_virtual_pad(struct input_id *id, const char *name);
+
+// Uses the GENERIC_PEN_* ranges
 int generic_create_virtual_pen(struct input_id *id, const char *name);
+int generic_create_virtual_pen_with_ranges(struct input_id *id, const char *name, const struct generic_pen_ranges_t *ranges);
 
 #endif
\ No newline at end of file
@@ -52,7 +52,21 @@ static const uint8_t abs_codes[] =
     ABS_MISC
 };
 
+const struct generic_pen_ranges_t generic_pen_ranges = (const struct generic_pen_ranges_t)
+{
+    .max_x          = GENERIC_PEN_MAX_X,
+    .max_y          = GENERIC_PEN_MAX_Y,
+    .max_pressure   = GENERIC_PEN_MAX_PRESSURE,
+    .max_tilt       = GENERIC_PEN_MAX_TILT,
+    .resolution     = GENERIC_PEN_RESOLUTION,
+};
+
 int generic_create_virtual_pen(struct input_id *id, const char *name)
+{
+    return generic_create_virtual_pen_with_ranges(id, name, &generic_pen_ranges);
+}
+
+int generic_create_virtual_pen_with_ranges(struct input_id *id, const char *name, const struct generic_pen_ranges_t *ranges)
 {
     int fd = -1, ret = 0;
     size_t size = 0, i = 0;
@@ -60,6 +74,7 @@ int generic_create_virtual_pen(struct input_id *id, const char *name)
     struct uinput_abs_setup abs_setup;
 
     VALIDATE(id != NULL, "cannot use invalid id for pen");
+    VALIDATE(ranges != NULL, "cannot use invalid ranges for pen");
     do
     {
         fd = open(FAKETABLETD_UINPUT_PATH, FAKETABLETD_UINTPUT_OFLAGS);
@@ -88,11 +103,11 @@ int generic_create_virtual_pen(struct input_id *id, const char *name)
         ret = ioctl(fd, UI_SET_MSCBIT, MSC_SERIAL);     if(ret < 0) break;
         
         // Setup absolute values
-        SET_ABS_PROPERTY(ABS_X, 0, 0, 50800, 200);      if(ret < 0) break;
-        SET_ABS_PROPERTY(ABS_Y, 0, 0, 31750, 200);      if(ret < 0) break;
-        SET_ABS_PROPERTY(ABS_PRESSURE, 0, 0, 8191, 0);  if(ret < 0) break;
-        SET_ABS_PROPERTY(ABS_TILT_X, 0, -60, 60, 0);    if(ret < 0) break;
-        SET_ABS_PROPERTY(ABS_TILT_Y, 0, -60, 60, 0);    if(ret < 0) break;
+        SET_ABS_PROPERTY(ABS_X, 0, 0, ranges->max_x, ranges->resolution);                   if(ret < 0) break;
+        SET_ABS_PROPERTY(ABS_Y, 0, 0, ranges->max_y, ranges->resolution);                   if(ret < 0) break;
+        SET_ABS_PROPERTY(ABS_PRESSURE, 0, 0, ranges->max_pressure, 0);                      if(ret < 0) break;
+        SET_ABS_PROPERTY(ABS_TILT_X, 0, -ranges->max_tilt, ranges->max_tilt, 0);            if(ret < 0) break;
+        SET_ABS_PROPERTY(ABS_TILT_Y, 0, -ranges->max_tilt, ranges->max_tilt, 0);            if(ret < 0) break;
         
         // Make sure the name is not too long for the setup
         size  = strlen(name);
@@ -0,0 +1,553 @@
+// Built once per MODEL in models.def, with model_config.h holding that
+// model's constants. Everything that depends on the model is settled at
+// compile time, either folded into the code or baked into the tables below
+#include "drivers/model/model.h"
+#include "model_config.h"
+#include "frame.h"
+#include "mapping.h"
+
+#define FORM_24BIT(a, b, c)         ((int32_t)(a) << 16 | (int32_t)(b) << 8 | (int32_t)(c))
+#define FORM_16BIT(a, b)            ((uint16_t)(a) << 8 | (uint16_t)(b))
+
+#ifdef VALIDATE
+#undef VALIDATE
+#define VALIDATE(_expr, _fmt, _args...)                 \
+{                                                       \
+    if(!(_expr))                                        \
+    {                                                   \
+        __ERROR(_fmt, ##_args);                         \
+        return -1;                                      \
+    }                                                   \
+}
+#endif
+
+// Queue event for the device behind fd. Everything goes out at once
+// when the report is done
+#define QUEUE_INPUT_EVENT(_fd, _type, _code, _value)            \
+{                                                               \
+    if(frame_append(&frame, _fd, _type, _code, _value) < 0)     \
+    {                                                           \
+        __WARNING("cannot queue event data");                   \
+        return -1;                                              \
+    }                                                           \
+}
+
+// What each value of the type byte stands for
+#define KIND(_b)                                                        \
+    (((_b) & MODEL_PEN_MASK) == 0 ? MODEL_KIND_PEN :                    \
+    (_b) == MODEL_FRAME_ID ? MODEL_KIND_FRAME :                         \
+    (_b) == MODEL_DIAL_ID ? MODEL_KIND_DIAL : MODEL_KIND_OTHER)
+#define KIND4(_b)   KIND(_b), KIND((_b) + 1), KIND((_b) + 2), KIND((_b) + 3)
+#define KIND16(_b)  KIND4(_b), KIND4((_b) + 4), KIND4((_b) + 8), KIND4((_b) + 12)
+#define KIND64(_b)  KIND16(_b), KIND16((_b) + 16), KIND16((_b) + 32), KIND16((_b) + 48)
+
+static const uint8_t report_kinds[256] = { KIND64(0), KIND64(64), KIND64(128), KIND64(192) };
+
+// The wacom driver can only take values from 0 to WHEEL_MAX, so dial
+// positions are spread over that, starting from the left
+#define DIAL_VALUE(_v)                                                                                      \
+    ((_v) == 0 ? 0 : ((MODEL_DIAL_OFFSET - (_v) + 2 * MODEL_DIAL_POSITIONS - 1) % MODEL_DIAL_POSITIONS + 1)  \
+        * MODEL_WHEEL_MAX / MODEL_DIAL_POSITIONS)
+#define DIAL4(_v)   DIAL_VALUE(_v), DIAL_VALUE((_v) + 1), DIAL_VALUE((_v) + 2), DIAL_VALUE((_v) + 3)
+
+static const int32_t dial_values[16] = { DIAL4(0), DIAL4(4), DIAL4(8), DIAL4(12) };
+
+_Static_assert(MODEL_DIAL_POSITIONS + 1 < 16, "dial has more positions than dial_values can hold");
+
+static const uint32_t btn_codes[] =
+{
+    BTN_0,
+    BTN_1,
+    BTN_2,
+    BTN_3,
+    BTN_4,
+    BTN_5,
+    BTN_6,
+    BTN_7,
+    BTN_8,
+    BTN_9,
+    BTN_A,
+    BTN_B,
+    BTN_C,
+    BTN_X,
+    BTN_Y,
+    BTN_Z
+};
+
+static const size_t btn_shortcuts[] =
+{
+    INI_BUTTON_1_INDEX,
+    INI_BUTTON_2_INDEX,
+    INI_BUTTON_3_INDEX,
+    INI_BUTTON_4_INDEX,
+    INI_BUTTON_5_INDEX,
+    INI_BUTTON_6_INDEX,
+    INI_BUTTON_7_INDEX,
+    INI_BUTTON_8_INDEX,
+    INI_BUTTON_9_INDEX,
+    INI_BUTTON_10_INDEX,
+    INI_BUTTON_11_INDEX,
+    INI_BUTTON_12_INDEX,
+    INI_BUTTON_13_INDEX,
+    INI_BUTTON_14_INDEX,
+    INI_BUTTON_15_INDEX,
+    INI_BUTTON_16_INDEX
+};
+
+_Static_assert(MODEL_BUTTON_COUNT <= GET_LEN(btn_codes), "model has more buttons than we have codes for");
+
+// Whatever bits the frame has past its last button are left alone
+#define BUTTON_MASK                 ((uint16_t)((1u << MODEL_BUTTON_COUNT) - 1))
+
+const char *MODEL_FUNCTION(get_device_name)()
+{
+    return MODEL_NAME;
+}
+
+const struct generic_pen_ranges_t MODEL_FUNCTION(pen_ranges) = (const struct generic_pen_ranges_t)
+{
+    .max_x          = MODEL_MAX_X,
+    .max_y          = MODEL_MAX_Y,
+    .max_pressure   = MODEL_MAX_PRESSURE,
+    .max_tilt       = MODEL_MAX_TILT,
+    .resolution     = MODEL_RESOLUTION,
+};
+
+int MODEL_FUNCTION(create_virtual_pen)(struct input_id *id, const char *name)
+{
+    return generic_create_virtual_pen_with_ranges(id, name, &MODEL_FUNCTION(pen_ranges));
+}
+
+int MODEL_FUNCTION(process_raw_input)(const struct raw_input_data_t *data)
+{
+    int ret = 0;
+    size_t i = 0;
+    uint8_t report_type = 0;
+    int32_t x_pos = 0, y_pos = 0, pres = 0;
+    struct driver_state_t *state = data->state;
+    struct frame_t frame;
+
+    VALIDATE(data->data != NULL, "cannot process NULL data");
+    VALIDATE(data->state != NULL, "cannot process data without a driver state");
+    VALIDATE(data->pad_device >= 0, "invalid virtual pad device");
+    VALIDATE(data->pen_device >= 0, "invalid virtual pen device");
+    VALIDATE(data->mapping != NULL, "cannot process data without a mapping");
+    VALIDATE(data->pressure != NULL, "cannot process data without a pressure curve");
+
+    if(data->size < MODEL_REPORT_SIZE || data->data[0] != MODEL_LEADING_BYTE) return 0;
+    report_type = data->data[MODEL_TYPE];
+
+    frame_begin(&frame, data->output);
+
+    switch (report_kinds[report_type])
+    {
+    case MODEL_KIND_PEN:
+    {
+        x_pos = FORM_24BIT(data->data[MODEL_X_HIGH], data->data[MODEL_X_MID], data->data[MODEL_X_LOW]);
+        y_pos = FORM_24BIT(data->data[MODEL_Y_HIGH], data->data[MODEL_Y_MID], data->data[MODEL_Y_LOW]);
+        pres = FORM_16BIT(data->data[MODEL_PRESSURE_HIGH], data->data[MODEL_PRESSURE_LOW]);
+        mapping_apply(data->mapping, &x_pos, &y_pos);
+
+        // Smoothing and prediction only make sense while there's a pen to
+        // follow
+        if(data->filter != NULL && (report_type & MODEL_IN_RANGE))
+            filter_apply(data->filter, &state->filter, data->timestamp, &x_pos, &y_pos, &pres);
+        else if(data->filter != NULL)
+            filter_reset(&state->filter);
+
+        if(data->predict != NULL && (report_type & MODEL_IN_RANGE))
+            predict_apply(data->predict, &state->predict, data->timestamp, (report_type & MODEL_TOUCH) != 0,
+                data->mapping->max_x, data->mapping->max_y, &x_pos, &y_pos);
+        else if(data->predict != NULL)
+            predict_reset(&state->predict);
+
+        // https://01.org/linuxgraphics/gfx-docs/drm/input/uinput.html
+        if(data->use_virtual_cursor && data->mouse_device > 0 && (report_type & MODEL_IN_RANGE))
+        {
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_REL, REL_X, mapping_cursor(data->mapping, x_pos - state->last_x));
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_REL, REL_Y, mapping_cursor(data->mapping, y_pos - state->last_y));
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_SYN, SYN_REPORT, 1);
+
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_KEY, BTN_LEFT, ((report_type & MODEL_TOUCH) != 0));
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_KEY, BTN_RIGHT, ((report_type & MODEL_STYLUS) != 0));
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_KEY, BTN_MIDDLE, ((report_type & MODEL_STYLUS2) != 0));
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_SYN, SYN_REPORT, 1);
+
+            state->last_x = x_pos;
+            state->last_y = y_pos;
+            break;
+        }
+
+        // If it's in range, send its coordinates and status to the virtual pen
+        if(report_type & MODEL_IN_RANGE)
+        {
+            QUEUE_INPUT_EVENT(data->pen_device, EV_ABS, ABS_X, x_pos);
+            QUEUE_INPUT_EVENT(data->pen_device, EV_ABS, ABS_Y, y_pos);
+            QUEUE_INPUT_EVENT(data->pen_device, EV_ABS, ABS_PRESSURE, pressure_apply(data->pressure, pres));
+            QUEUE_INPUT_EVENT(data->pen_device, EV_ABS, ABS_TILT_X, (int8_t)data->data[MODEL_TILT_X]);
+            QUEUE_INPUT_EVENT(data->pen_device, EV_ABS, ABS_TILT_Y, MODEL_TILT_Y_SIGN * (int8_t)data->data[MODEL_TILT_Y]);
+
+            QUEUE_INPUT_EVENT(data->pen_device, EV_KEY, BTN_TOUCH, ((report_type & MODEL_TOUCH) != 0));
+            QUEUE_INPUT_EVENT(data->pen_device, EV_KEY, BTN_STYLUS, ((report_type & MODEL_STYLUS) != 0));
+            QUEUE_INPUT_EVENT(data->pen_device, EV_KEY, BTN_STYLUS2, ((report_type & MODEL_STYLUS2) != 0));
+        }
+        // Otherwise, let the virtual pen know we are not touching the frame
+        else
+            QUEUE_INPUT_EVENT(data->pen_device, EV_KEY, BTN_TOOL_PEN, 0);
+
+        // A serial number is required when sending button press
+        // events from a pen device. Or somthing like that... It goes
+        // in the same packet as the rest, so a report that changes
+        // nothing doesn't send anything at all
+        QUEUE_INPUT_EVENT(data->pen_device, EV_MSC, MSC_SERIAL, 1098942556);
+        QUEUE_INPUT_EVENT(data->pen_device, EV_SYN, SYN_REPORT, 1);
+        break;
+    }
+    case MODEL_KIND_FRAME:
+    {
+        // Each bit in btn_pressed represents the state of a button
+        uint16_t btns_pressed = FORM_16BIT(data->data[MODEL_BUTTONS_HIGH], data->data[MODEL_BUTTONS_LOW]) & BUTTON_MASK;
+        uint16_t btns_changed = 0, btns = 0;
+        struct frame_shadow_t *shadow = frame_find_shadow(&frame, data->pad_device);
+
+        // Only changes go out, so if any of them never made it, start over
+        // from what the pad really got
+        if(shadow != NULL && shadow->keys_lost)
+        {
+            state->pad_buttons = 0;
+            for(i = 0; i < MODEL_BUTTON_COUNT; i++)
+                state->pad_buttons |= ((shadow->keys[btn_codes[i] / 64] >> (btn_codes[i] % 64)) & 1) << i;
+            shadow->keys_lost = false;
+        }
+        btns_changed = btns_pressed ^ state->pad_buttons;
+
+        // I don't know what this is for, but I guess that it
+        // tells the virtual device a button has been pressed?
+        QUEUE_INPUT_EVENT(data->pad_device, EV_ABS, ABS_MISC, btns_pressed ? 15 : 0);
+
+        // Only the buttons that went up or down since the last report
+        for(btns = btns_changed; btns != 0; btns &= btns - 1)
+        {
+            i = __builtin_ctz(btns);
+            QUEUE_INPUT_EVENT(data->pad_device, EV_KEY, btn_codes[i], (btns_pressed >> i) & 0x01);
+        }
+        state->pad_buttons = btns_pressed;
+
+        // Shortcuts fire once per press, not for as long as the button is
+        // held
+        if(data->config_available && data->keyboard_device >= 0)
+        {
+            for(btns = btns_changed & btns_pressed; btns != 0; btns &= btns - 1)
+            {
+                i = __builtin_ctz(btns);
+                if(ini_item_is_populated(btn_shortcuts[i]) && (ret = simulate_key_presses(&frame, data->keyboard_device,
+                    ini_get_item(btn_shortcuts[i], const char *)
+                )) < 0) return ret;
+            }
+        }
+
+        QUEUE_INPUT_EVENT(data->pad_device, EV_SYN, SYN_REPORT, 1);
+        break;
+    }
+    case MODEL_KIND_DIAL:
+    {
+        int32_t dial_value = data->data[MODEL_DIAL];
+        if(dial_value >= (int32_t)GET_LEN(dial_values))
+            return 0;
+
+        // The dial only scrolls with -s, and only once there's a mouse to
+        // scroll with
+        if(!data->use_virtual_wheel || data->mouse_device < 0)
+        {
+            // https://github.com/DIGImend/digimend-kernel-drivers/issues/275#issuecomment-667822380
+            QUEUE_INPUT_EVENT(data->pad_device, EV_ABS, ABS_MISC, dial_value > 0 ? 15 : 0);
+            QUEUE_INPUT_EVENT(data->pad_device, EV_ABS, ABS_WHEEL, dial_values[dial_value]);
+            QUEUE_INPUT_EVENT(data->pad_device, EV_SYN, SYN_REPORT, 0);
+        }
+        else if(dial_value != 0)
+        {
+            int step = MODEL_WHEEL_STEP;
+            if(dial_value < state->scroll_wheel_buffer || (state->scroll_wheel_buffer == 1 && dial_value == MODEL_DIAL_POSITIONS + 1))
+                step = -step;
+
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_REL, REL_WHEEL, step);
+            QUEUE_INPUT_EVENT(data->mouse_device, EV_SYN, SYN_REPORT, 0);
+            state->scroll_wheel_buffer = dial_value;
+        }
+        break;
+    }
+    default:
+        return 0;
+    }
+
+    return frame_commit(&frame);
+}
+
+// Batch decoding, for going through captures rather than live reports.
+// Every report is decoded the same way regardless of its kind, which is
+// what lets several go through at once. With SIMD, the first 16 bytes of
+// each report are shuffled so every value lands in a 32 bit lane of its
+// own:
+//
+//  lane 0  x low, x mid, x high, leading byte
+//  lane 1  y low, y mid, y high, type
+//  lane 2  pressure low, pressure high, buttons low, buttons high
+//  lane 3  tilt x, tilt y, dial, nothing
+//
+// and four of those transposed leave a vector per value, four reports
+// wide. On avx2 each half of a register does the same for four more
+#if (defined(__x86_64__) || defined(__i386__)) && MODEL_X_LOW < 16 && MODEL_X_MID < 16 && MODEL_X_HIGH < 16 &&     \
+    MODEL_Y_LOW < 16 && MODEL_Y_MID < 16 && MODEL_Y_HIGH < 16 && MODEL_TYPE < 16 &&                             \
+    MODEL_PRESSURE_LOW < 16 && MODEL_PRESSURE_HIGH < 16 && MODEL_BUTTONS_LOW < 16 && MODEL_BUTTONS_HIGH < 16 &&  \
+    MODEL_TILT_X < 16 && MODEL_TILT_Y < 16 && MODEL_DIAL < 16
+#define BATCH_SIMD
+#include <immintrin.h>
+#endif
+
+_Static_assert(REPORT_MAX_SIZE >= 16, "batch decoding reads 16 bytes from every report");
+
+// Picks bytes 0, 4, 8, 12 / words 0, 2, 4, 6 out of 32 bit lanes
+#define BATCH_PACK8     0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define BATCH_PACK16    0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1
+#define BATCH_HIGH16    2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1
+#define BATCH_SHUFFLE                                                                   \
+    MODEL_X_LOW, MODEL_X_MID, MODEL_X_HIGH, 0,                                          \
+    MODEL_Y_LOW, MODEL_Y_MID, MODEL_Y_HIGH, MODEL_TYPE,                                 \
+    MODEL_PRESSURE_LOW, MODEL_PRESSURE_HIGH, MODEL_BUTTONS_LOW, MODEL_BUTTONS_HIGH,     \
+    MODEL_TILT_X, MODEL_TILT_Y, MODEL_DIAL, -1
+
+// Reports from first on, one at a time. Also takes whatever is left over
+// after the SIMD versions are done
+static void decode_batch_scalar(const struct report_t *reports, size_t first, size_t count, struct model_batch_t *batch)
+{
+    const uint8_t *data = NULL;
+
+    for(size_t i = first; i < count; i++)
+    {
+        data = reports[i].data;
+        batch->kinds[i] = reports[i].size < MODEL_REPORT_SIZE || data[0] != MODEL_LEADING_BYTE ?
+            MODEL_KIND_OTHER : report_kinds[data[MODEL_TYPE]];
+        batch->flags[i] = data[MODEL_TYPE];
+        batch->x[i] = FORM_24BIT(data[MODEL_X_HIGH], data[MODEL_X_MID], data[MODEL_X_LOW]);
+        batch->y[i] = FORM_24BIT(data[MODEL_Y_HIGH], data[MODEL_Y_MID], data[MODEL_Y_LOW]);
+        batch->pressure[i] = FORM_16BIT(data[MODEL_PRESSURE_HIGH], data[MODEL_PRESSURE_LOW]);
+        batch->tilt_x[i] = (int8_t)data[MODEL_TILT_X];
+        batch->tilt_y[i] = MODEL_TILT_Y_SIGN * (int8_t)data[MODEL_TILT_Y];
+        batch->buttons[i] = FORM_16BIT(data[MODEL_BUTTONS_HIGH], data[MODEL_BUTTONS_LOW]) & BUTTON_MASK;
+        batch->dial[i] = data[MODEL_DIAL];
+    }
+}
+
+#ifdef BATCH_SIMD
+// The byte and flag arrays have no alignment to speak of
+static inline void store32(void *dst, int32_t value)
+{
+    memcpy(dst, &value, sizeof(value));
+}
+
+__attribute__((target("ssse3")))
+static void decode_batch_ssse3(const struct report_t *reports, size_t count, struct model_batch_t *batch)
+{
+    size_t i = 0;
+    __m128i r0, r1, r2, r3, t0, t1, t2, t3, xs, ys, ps, ts, type, valid, pen, frame, dial, kinds, tilt_y;
+    const __m128i shuffle = _mm_setr_epi8(BATCH_SHUFFLE), zero = _mm_setzero_si128();
+    const __m128i pack8 = _mm_setr_epi8(BATCH_PACK8), pack16 = _mm_setr_epi8(BATCH_PACK16), high16 = _mm_setr_epi8(BATCH_HIGH16);
+    const __m128i mask24 = _mm_set1_epi32(0xffffff);
+
+    for(; i + 4 <= count; i += 4)
+    {
+        r0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)reports[i].data), shuffle);
+        r1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)reports[i + 1].data), shuffle);
+        r2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)reports[i + 2].data), shuffle);
+        r3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)reports[i + 3].data), shuffle);
+
+        t0 = _mm_unpacklo_epi32(r0, r1);
+        t1 = _mm_unpacklo_epi32(r2, r3);
+        t2 = _mm_unpackhi_epi32(r0, r1);
+        t3 = _mm_unpackhi_epi32(r2, r3);
+        xs = _mm_unpacklo_epi64(t0, t1);
+        ys = _mm_unpackhi_epi64(t0, t1);
+        ps = _mm_unpacklo_epi64(t2, t3);
+        ts = _mm_unpackhi_epi64(t2, t3);
+
+        // Same order of precedence as the KIND macro
+        type = _mm_srli_epi32(ys, 24);
+        valid = _mm_and_si128(
+            _mm_cmpeq_epi32(_mm_srli_epi32(xs, 24), _mm_set1_epi32(MODEL_LEADING_BYTE)),
+            _mm_cmpgt_epi32(
+                _mm_setr_epi32(reports[i].size, reports[i + 1].size, reports[i + 2].size, reports[i + 3].size),
+                _mm_set1_epi32(MODEL_REPORT_SIZE - 1)
+            )
+        );
+        pen = _mm_cmpeq_epi32(_mm_and_si128(type, _mm_set1_epi32(MODEL_PEN_MASK)), zero);
+        frame = _mm_cmpeq_epi32(type, _mm_set1_epi32(MODEL_FRAME_ID));
+        dial = _mm_cmpeq_epi32(type, _mm_set1_epi32(MODEL_DIAL_ID));
+        kinds = _mm_and_si128(dial, _mm_set1_epi32(MODEL_KIND_DIAL));
+        kinds = _mm_or_si128(_mm_andnot_si128(frame, kinds), _mm_and_si128(frame, _mm_set1_epi32(MODEL_KIND_FRAME)));
+        kinds = _mm_or_si128(_mm_andnot_si128(pen, kinds), _mm_and_si128(pen, _mm_set1_epi32(MODEL_KIND_PEN)));
+        kinds = _mm_and_si128(kinds, valid);
+
+        tilt_y = _mm_srai_epi32(_mm_slli_epi32(ts, 16), 24);
+        if(MODEL_TILT_Y_SIGN < 0)
+            tilt_y = _mm_sub_epi32(zero, tilt_y);
+
+        store32(&batch->kinds[i], _mm_cvtsi128_si32(_mm_shuffle_epi8(kinds, pack8)));
+        store32(&batch->flags[i], _mm_cvtsi128_si32(_mm_shuffle_epi8(type, pack8)));
+        store32(&batch->dial[i], _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm_srli_epi32(_mm_slli_epi32(ts, 8), 24), pack8)));
+        _mm_storeu_si128((__m128i *)&batch->x[i], _mm_and_si128(xs, mask24));
+        _mm_storeu_si128((__m128i *)&batch->y[i], _mm_and_si128(ys, mask24));
+        _mm_storel_epi64((__m128i *)&batch->pressure[i], _mm_shuffle_epi8(ps, pack16));
+        _mm_storel_epi64((__m128i *)&batch->buttons[i], _mm_and_si128(_mm_shuffle_epi8(ps, high16), _mm_set1_epi16(BUTTON_MASK)));
+        _mm_storel_epi64((__m128i *)&batch->tilt_x[i], _mm_shuffle_epi8(_mm_srai_epi32(_mm_slli_epi32(ts, 24), 24), pack16));
+        _mm_storel_epi64((__m128i *)&batch->tilt_y[i], _mm_shuffle_epi8(tilt_y, pack16));
+    }
+
+    decode_batch_scalar(reports, i, count, batch);
+}
+
+__attribute__((target("avx2")))
+static void decode_batch_avx2(const struct report_t *reports, size_t count, struct model_batch_t *batch)
+{
+    size_t i = 0;
+    __m256i r0, r1, r2, r3, t0, t1, t2, t3, xs, ys, ps, ts, type, valid, pen, frame, dial, kinds, tilt_y;
+    const __m256i shuffle = _mm256_setr_epi8(BATCH_SHUFFLE, BATCH_SHUFFLE), zero = _mm256_setzero_si256();
+    const __m256i pack8 = _mm256_setr_epi8(BATCH_PACK8, BATCH_PACK8), pack16 = _mm256_setr_epi8(BATCH_PACK16, BATCH_PACK16);
+    const __m256i high16 = _mm256_setr_epi8(BATCH_HIGH16, BATCH_HIGH16), mask24 = _mm256_set1_epi32(0xffffff);
+    // Brings the bytes each half packed together
+    const __m256i join8 = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+#define BATCH_LOAD2(_a, _b)                                                                 \
+    _mm256_shuffle_epi8(_mm256_inserti128_si256(                                            \
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)reports[_a].data)),         \
+        _mm_loadu_si128((const __m128i *)reports[_b].data), 1), shuffle)
+#define BATCH_JOIN8(_v)     _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_v, pack8), join8))
+#define BATCH_JOIN16(_v)    _mm256_castsi256_si128(_mm256_permute4x64_epi64(_v, _MM_SHUFFLE(3, 1, 2, 0)))
+
+    for(; i + 8 <= count; i += 8)
+    {
+        r0 = BATCH_LOAD2(i, i + 4);
+        r1 = BATCH_LOAD2(i + 1, i + 5);
+        r2 = BATCH_LOAD2(i + 2, i + 6);
+        r3 = BATCH_LOAD2(i + 3, i + 7);
+
+        t0 = _mm256_unpacklo_epi32(r0, r1);
+        t1 = _mm256_unpacklo_epi32(r2, r3);
+        t2 = _mm256_unpackhi_epi32(r0, r1);
+        t3 = _mm256_unpackhi_epi32(r2, r3);
+        xs = _mm256_unpacklo_epi64(t0, t1);
+        ys = _mm256_unpackhi_epi64(t0, t1);
+        ps = _mm256_unpacklo_epi64(t2, t3);
+        ts = _mm256_unpackhi_epi64(t2, t3);
+
+        type = _mm256_srli_epi32(ys, 24);
+        valid = _mm256_and_si256(
+            _mm256_cmpeq_epi32(_mm256_srli_epi32(xs, 24), _mm256_set1_epi32(MODEL_LEADING_BYTE)),
+            _mm256_cmpgt_epi32(
+                _mm256_setr_epi32(
+                    reports[i].size, reports[i + 1].size, reports[i + 2].size, reports[i + 3].size,
+                    reports[i + 4].size, reports[i + 5].size, reports[i + 6].size, reports[i + 7].size
+                ),
+                _mm256_set1_epi32(MODEL_REPORT_SIZE - 1)
+            )
+        );
+        pen = _mm256_cmpeq_epi32(_mm256_and_si256(type, _mm256_set1_epi32(MODEL_PEN_MASK)), zero);
+        frame = _mm256_cmpeq_epi32(type, _mm256_set1_epi32(MODEL_FRAME_ID));
+        dial = _mm256_cmpeq_epi32(type, _mm256_set1_epi32(MODEL_DIAL_ID));
+        kinds = _mm256_and_si256(dial, _mm256_set1_epi32(MODEL_KIND_DIAL));
+        kinds = _mm256_blendv_epi8(kinds, _mm256_set1_epi32(MODEL_KIND_FRAME), frame);
+        kinds = _mm256_blendv_epi8(kinds, _mm256_set1_epi32(MODEL_KIND_PEN), pen);
+        kinds = _mm256_and_si256(kinds, valid);
+
+        tilt_y = _mm256_srai_epi32(_mm256_slli_epi32(ts, 16), 24);
+        if(MODEL_TILT_Y_SIGN < 0)
+            tilt_y = _mm256_sub_epi32(zero, tilt_y);
+
+        _mm_storel_epi64((__m128i *)&batch->kinds[i], BATCH_JOIN8(kinds));
+        _mm_storel_epi64((__m128i *)&batch->flags[i], BATCH_JOIN8(type));
+        _mm_storel_epi64((__m128i *)&batch->dial[i], BATCH_JOIN8(_mm256_srli_epi32(_mm256_slli_epi32(ts, 8), 24)));
+        _mm256_storeu_si256((__m256i *)&batch->x[i], _mm256_and_si256(xs, mask24));
+        _mm256_storeu_si256((__m256i *)&batch->y[i], _mm256_and_si256(ys, mask24));
+        _mm_storeu_si128((__m128i *)&batch->pressure[i], BATCH_JOIN16(_mm256_shuffle_epi8(ps, pack16)));
+        _mm_storeu_si128((__m128i *)&batch->buttons[i], _mm_and_si128(
+            BATCH_JOIN16(_mm256_shuffle_epi8(ps, high16)), _mm_set1_epi16(BUTTON_MASK)
+        ));
+        _mm_storeu_si128((__m128i *)&batch->tilt_x[i], BATCH_JOIN16(_mm256_shuffle_epi8(_mm256_srai_epi32(_mm256_slli_epi32(ts, 24), 24), pack16)));
+        _mm_storeu_si128((__m128i *)&batch->tilt_y[i], BATCH_JOIN16(_mm256_shuffle_epi8(tilt_y, pack16)));
+    }
+
+#undef BATCH_LOAD2
+#undef BATCH_JOIN8
+#undef BATCH_JOIN16
+
+    decode_batch_scalar(reports, i, count, batch);
+}
+#endif
+
+static void decode_batch_plain(const struct report_t *reports, size_t count, struct model_batch_t *batch)
+{
+    decode_batch_scalar(reports, 0, count, batch);
+}
+
+// Settled the first time through, the CPU isn't going anywhere
+static void (*batch_decoder)(const struct report_t *, size_t, struct model_batch_t *) = NULL;
+static const char *batch_engine_name = NULL;
+
+static void pick_batch_decoder()
+{
+    batch_decoder = decode_batch_plain;
+    batch_engine_name = "scalar";
+
+#ifdef BATCH_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        batch_decoder = decode_batch_avx2;
+        batch_engine_name = "avx2";
+    }
+    else if(__builtin_cpu_supports("ssse3"))
+    {
+        batch_decoder = decode_batch_ssse3;
+        batch_engine_name = "ssse3";
+    }
+#endif
+}
+
+void MODEL_FUNCTION(decode_batch)(const struct report_t *reports, size_t count, struct model_batch_t *batch)
+{
+    if(batch_decoder == NULL)
+        pick_batch_decoder();
+    batch_decoder(reports, count, batch);
+}
+
+const char *MODEL_FUNCTION(batch_engine)()
+{
+    if(batch_decoder == NULL)
+        pick_batch_decoder();
+    return batch_engine_name;
+}
+
+int MODEL_FUNCTION(select_batch_engine)(const char *engine)
+{
+    pick_batch_decoder();
+    if(engine == NULL || strcmp(engine, batch_engine_name) == 0)
+        return 0;
+
+    if(strcmp(engine, "scalar") == 0)
+    {
+        batch_decoder = decode_batch_plain;
+        batch_engine_name = "scalar";
+        return 0;
+    }
+
+#ifdef BATCH_SIMD
+    // Whatever pick_batch_decoder went for is already out of the way
+    if(strcmp(engine, "ssse3") == 0 && __builtin_cpu_supports("ssse3"))
+    {
+        batch_decoder = decode_batch_ssse3;
+        batch_engine_name = "ssse3";
+        return 0;
+    }
+#endif
+
+    return -1;
+}
@@ -0,0 +1,51 @@
+#ifndef FAKETABLETD_DRIVERS_MODEL_H__
+#define FAKETABLETD_DRIVERS_MODEL_H__
+
+#include "drivers/generic/generic.h"
+
+// What a report turned out to be, going by its type byte
+#define MODEL_KIND_OTHER            0
+#define MODEL_KIND_PEN              1
+#define MODEL_KIND_FRAME            2
+#define MODEL_KIND_DIAL             3
+
+// Many reports decoded at once, one array per value. Every array holds at
+// least as many entries as the reports handed to decode_batch, and every
+// value is filled in for every report, whether it means anything for that
+// kind of report or not (buttons are only there on frame reports, the dial
+// on dial ones and everything else on pen ones)
+struct model_batch_t
+{
+    uint8_t *kinds;
+    // The type byte, with the in range, touch and stylus bits
+    uint8_t *flags;
+    int32_t *x;
+    int32_t *y;
+    uint16_t *pressure;
+    int16_t *tilt_x;
+    int16_t *tilt_y;
+    uint16_t *buttons;
+    // Raw dial position, 0 when left alone
+    uint8_t *dial;
+};
+
+// What every library built from models.def exports, named after its model.
+// decode_batch only pulls values out of the reports, it doesn't send
+// anything anywhere. batch_engine says whether it runs on avx2, ssse3 or
+// plain C on this machine, and select_batch_engine makes it run on the one
+// called engine instead (NULL going back to the best one). That returns -1
+// if the engine isn't built in or the CPU can't run it
+#define MODEL(_name, ...)                                                                                 \
+    int _name##_process_raw_input(const struct raw_input_data_t *data);                                   \
+    void _name##_decode_batch(const struct report_t *reports, size_t count, struct model_batch_t *batch); \
+    const char *_name##_batch_engine();                                                                   \
+    int _name##_select_batch_engine(const char *engine);                                                  \
+    int _name##_create_virtual_pen(struct input_id *id, const char *name);                                \
+    extern const struct generic_pen_ranges_t _name##_pen_ranges;                                          \
+    const char *_name##_get_device_name();
+#define DEVICE(_vendor_id, _product_id, _name)
+#include "drivers/models.def"
+#undef MODEL
+#undef DEVICE
+
+#endif
@@ -0,0 +1,152 @@
+#include "drivers/rdesc/rdesc.h"
+#include "frame.h"
+#include "sink.h"
+#include "mapping.h"
+
+#ifdef VALIDATE
+#undef VALIDATE
+#define VALIDATE(_expr, _fmt, _args...)                 \
+{                                                       \
+    if(!(_expr))                                        \
+    {                                                   \
+        __ERROR(_fmt, ##_args);                         \
+        return -1;                                      \
+    }                                                   \
+}
+#endif
+
+// Queue event for the device behind fd. Everything goes out at once
+// when the report is done
+#define QUEUE_INPUT_EVENT(_fd, _type, _code, _value)            \
+{                                                               \
+    if(frame_append(&frame, _fd, _type, _code, _value) < 0)     \
+    {                                                           \
+        __WARNING("cannot queue event data");                   \
+        return -1;                                              \
+    }                                                           \
+}
+
+// Same serial the HS610 driver uses
+#define PEN_SERIAL                  1098942556
+
+int rdesc_process_raw_input(const struct raw_input_data_t *data)
+{
+    int ret = 0, fd = -1, fds[SINK_DEVICE_COUNT];
+    bool in_range = true, pad_active = false, has_buttons = false, has_position = false;
+    size_t i = 0;
+    int32_t value = 0, x = 0, y = 0;
+    uint16_t btns_pressed = 0, btns = 0;
+    uint32_t values[HID_MAX_SLOTS];
+    struct driver_state_t *state = data->state;
+    const struct hid_report_plan_t *report = NULL;
+    const struct hid_field_t *field = NULL;
+    const struct hid_slot_t *slot = NULL;
+    struct frame_t frame;
+
+    VALIDATE(data->data != NULL, "cannot process NULL data");
+    VALIDATE(data->state != NULL, "cannot process data without a driver state");
+    VALIDATE(data->plan != NULL, "cannot process data without a report plan");
+    VALIDATE(data->mapping != NULL, "cannot process data without a mapping");
+    VALIDATE(data->pressure != NULL, "cannot process data without a pressure curve");
+
+    if((report = hid_find_report(data->plan, data->data, data->size)) == NULL) return 0;
+
+    fds[SINK_DEVICE_PAD] = data->pad_device;
+    fds[SINK_DEVICE_PEN] = data->pen_device;
+    fds[SINK_DEVICE_MOUSE] = data->mouse_device;
+    fds[SINK_DEVICE_KEYBOARD] = data->keyboard_device;
+
+    // Put every slot back together first, some are spread over a few fields
+    for(i = 0; i < report->slot_count; i++)
+        values[i] = 0;
+    for(i = 0; i < report->field_count; i++)
+    {
+        field = &report->fields[i];
+        values[field->slot] |= hid_extract(data->data, field) << field->shift;
+    }
+
+    if(report->in_range_slot != HID_NO_SLOT)
+        in_range = values[report->in_range_slot] != 0;
+
+    // Rotating the area mixes both axes up, so they go through the mapping
+    // together
+    if(report->x_slot != HID_NO_SLOT && report->y_slot != HID_NO_SLOT)
+    {
+        has_position = true;
+        x = hid_slot_value(&report->slots[report->x_slot], values[report->x_slot]);
+        y = hid_slot_value(&report->slots[report->y_slot], values[report->y_slot]);
+        mapping_apply(data->mapping, &x, &y);
+    }
+
+    frame_begin(&frame, data->output);
+
+    for(i = 0; i < report->slot_count; i++)
+    {
+        slot = &report->slots[i];
+        if((fd = fds[slot->device]) < 0)
+            continue;
+
+        // Whatever the tablet says the position is once the pen is gone,
+        // it's not where the pen is
+        if(slot->device == SINK_DEVICE_PEN && slot->type == EV_ABS && !in_range)
+            continue;
+
+        if(has_position && i == report->x_slot)
+            value = x;
+        else if(has_position && i == report->y_slot)
+            value = y;
+        else if(i == report->pressure_slot)
+            value = pressure_apply(data->pressure, hid_slot_value(slot, values[i]));
+        else
+            value = hid_slot_value(slot, values[i]);
+        if(slot->device == SINK_DEVICE_PAD)
+        {
+            pad_active |= value != 0;
+            if(slot->button != HID_NO_BUTTON)
+            {
+                has_buttons = true;
+                btns_pressed |= (value != 0) << slot->button;
+            }
+        }
+
+        QUEUE_INPUT_EVENT(fd, slot->type, slot->code, value);
+    }
+
+    if(report->has_pen && data->pen_device >= 0)
+    {
+        // A serial number is required when sending button press
+        // events from a pen device
+        QUEUE_INPUT_EVENT(data->pen_device, EV_MSC, MSC_SERIAL, PEN_SERIAL);
+        QUEUE_INPUT_EVENT(data->pen_device, EV_SYN, SYN_REPORT, 1);
+    }
+
+    if(report->has_pad && data->pad_device >= 0)
+    {
+        // Tells the wacom driver something on the pad is in use
+        QUEUE_INPUT_EVENT(data->pad_device, EV_ABS, ABS_MISC, pad_active ? 15 : 0);
+
+        // Shortcuts fire once per press, not for as long as the button is
+        // held. The buttons themselves go out on every report and the
+        // shadow drops the ones that didn't change, so any that were lost
+        // on the way go again by themselves
+        if(has_buttons && data->config_available && data->keyboard_device >= 0)
+        {
+            for(btns = (btns_pressed ^ state->pad_buttons) & btns_pressed; btns != 0; btns &= btns - 1)
+            {
+                i = __builtin_ctz(btns);
+                if(ini_item_is_populated(INI_BUTTON_1_INDEX + i) && (ret = simulate_key_presses(&frame, data->keyboard_device,
+                    ini_get_item(INI_BUTTON_1_INDEX + i, const char *)
+                )) < 0) return ret;
+            }
+        }
+        if(has_buttons)
+            state->pad_buttons = btns_pressed;
+
+        QUEUE_INPUT_EVENT(data->pad_device, EV_SYN, SYN_REPORT, 1);
+    }
+
+    if(report->has_mouse && data->mouse_device >= 0)
+        QUEUE_INPUT_EVENT(data->mouse_device, EV_SYN, SYN_REPORT, 1);
+
+    return frame_commit(&frame);
+}
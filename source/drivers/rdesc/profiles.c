@@ -0,0 +1,118 @@
+#include "drivers/rdesc/rdesc.h"
+
+const struct hid_profile_t device_hid_profile = (const struct hid_profile_t){};
+
+// Huion tablets switch to their full resolution reports once string 0xc8
+// is read (the transports always do), and from then on everything comes
+// in under ID 8 with the second byte telling pen, frame and dial apart.
+// The descriptor below describes those reports the way the HS610 sends
+// them, with the frame and dial moved to IDs of their own:
+//
+//  pen     08 | tip, barrel, barrel 2, 4 bits of padding, in range
+//          x (16) | y (16) | pressure (16) | x high (8) | y high (8) | tilt x | tilt y
+//  frame   e0 | 3 bytes we don't know about | buttons (16) | padding
+//  dial    f0 | 4 bytes we don't know about | wheel | padding
+static const uint8_t huion_descriptor[] =
+{
+    0x05, 0x0d,                     // Usage Page (Digitizer)
+    0x09, 0x02,                     // Usage (Pen)
+    0xa1, 0x01,                     // Collection (Application)
+    0x85, 0x08,                     //   Report ID (8)
+    0x09, 0x20,                     //   Usage (Stylus)
+    0xa1, 0x00,                     //   Collection (Physical)
+    0x09, 0x42,                     //     Usage (Tip Switch)
+    0x09, 0x44,                     //     Usage (Barrel Switch)
+    0x09, 0x5a,                     //     Usage (Secondary Barrel Switch)
+    0x15, 0x00,                     //     Logical Minimum (0)
+    0x25, 0x01,                     //     Logical Maximum (1)
+    0x75, 0x01,                     //     Report Size (1)
+    0x95, 0x03,                     //     Report Count (3)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0x95, 0x04,                     //     Report Count (4)
+    0x81, 0x03,                     //     Input (Constant)
+    0x09, 0x32,                     //     Usage (In Range)
+    0x95, 0x01,                     //     Report Count (1)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0x05, 0x01,                     //     Usage Page (Generic Desktop)
+    0x09, 0x30,                     //     Usage (X)
+    0x09, 0x31,                     //     Usage (Y)
+    0x27, 0xff, 0xff, 0x00, 0x00,   //     Logical Maximum (65535)
+    0x75, 0x10,                     //     Report Size (16)
+    0x95, 0x02,                     //     Report Count (2)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0x05, 0x0d,                     //     Usage Page (Digitizer)
+    0x09, 0x30,                     //     Usage (Tip Pressure)
+    0x26, 0xff, 0x1f,               //     Logical Maximum (8191)
+    0x95, 0x01,                     //     Report Count (1)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0x05, 0x01,                     //     Usage Page (Generic Desktop)
+    0x09, 0x30,                     //     Usage (X), high byte
+    0x27, 0x70, 0xc6, 0x00, 0x00,   //     Logical Maximum (50800)
+    0x75, 0x08,                     //     Report Size (8)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0x09, 0x31,                     //     Usage (Y), high byte
+    0x27, 0x06, 0x7c, 0x00, 0x00,   //     Logical Maximum (31750)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0x05, 0x0d,                     //     Usage Page (Digitizer)
+    0x09, 0x3d,                     //     Usage (X Tilt)
+    0x09, 0x3e,                     //     Usage (Y Tilt)
+    0x15, 0xc4,                     //     Logical Minimum (-60)
+    0x25, 0x3c,                     //     Logical Maximum (60)
+    0x95, 0x02,                     //     Report Count (2)
+    0x81, 0x02,                     //     Input (Data, Variable, Absolute)
+    0xc0,                           //   End Collection
+    0xc0,                           // End Collection
+
+    0x05, 0x0d,                     // Usage Page (Digitizer)
+    0x09, 0x39,                     // Usage (Tablet Function Keys)
+    0xa1, 0x01,                     // Collection (Application)
+    0x85, 0xe0,                     //   Report ID (0xe0)
+    0x75, 0x08,                     //   Report Size (8)
+    0x95, 0x03,                     //   Report Count (3)
+    0x81, 0x03,                     //   Input (Constant)
+    0x05, 0x09,                     //   Usage Page (Button)
+    0x19, 0x01,                     //   Usage Minimum (1)
+    0x29, 0x10,                     //   Usage Maximum (16)
+    0x15, 0x00,                     //   Logical Minimum (0)
+    0x25, 0x01,                     //   Logical Maximum (1)
+    0x75, 0x01,                     //   Report Size (1)
+    0x95, 0x10,                     //   Report Count (16)
+    0x81, 0x02,                     //   Input (Data, Variable, Absolute)
+    0x75, 0x08,                     //   Report Size (8)
+    0x95, 0x06,                     //   Report Count (6)
+    0x81, 0x03,                     //   Input (Constant)
+    0xc0,                           // End Collection
+
+    0x05, 0x0d,                     // Usage Page (Digitizer)
+    0x09, 0x39,                     // Usage (Tablet Function Keys)
+    0xa1, 0x01,                     // Collection (Application)
+    0x85, 0xf0,                     //   Report ID (0xf0)
+    0x75, 0x08,                     //   Report Size (8)
+    0x95, 0x04,                     //   Report Count (4)
+    0x81, 0x03,                     //   Input (Constant)
+    0x05, 0x01,                     //   Usage Page (Generic Desktop)
+    0x09, 0x38,                     //   Usage (Wheel)
+    0x15, 0x00,                     //   Logical Minimum (0)
+    0x25, 0x0d,                     //   Logical Maximum (13)
+    0x95, 0x01,                     //   Report Count (1)
+    0x81, 0x02,                     //   Input (Data, Variable, Absolute)
+    0x95, 0x06,                     //   Report Count (6)
+    0x81, 0x03,                     //   Input (Constant)
+    0xc0,                           // End Collection
+};
+
+static const struct hid_subreports_t huion_subreports = (const struct hid_subreports_t)
+{
+    .id = 0x08,
+    .offset = 1,
+    .mask = 0xf0,
+    .count = 2,
+    .map = { { .value = 0xe0, .id = 0xe0 }, { .value = 0xf0, .id = 0xf0 } },
+};
+
+const struct hid_profile_t huion_hid_profile = (const struct hid_profile_t)
+{
+    .descriptor = huion_descriptor,
+    .descriptor_size = sizeof(huion_descriptor),
+    .subreports = &huion_subreports,
+};
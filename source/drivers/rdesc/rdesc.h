@@ -0,0 +1,19 @@
+#ifndef FAKETABLETD_DRIVERS_RDESC_H__
+#define FAKETABLETD_DRIVERS_RDESC_H__
+
+#include "drivers/generic/generic.h"
+#include "hid.h"
+
+// Runs reports through the plan built from the device's report descriptor
+// (data->plan), so any tablet with a sane descriptor works without a
+// driver of its own
+int rdesc_process_raw_input(const struct raw_input_data_t *data);
+
+// Takes the descriptor from the device
+extern const struct hid_profile_t device_hid_profile;
+
+// Huion (and Gaomon) tablets in full resolution mode, which send reports
+// their own descriptor knows nothing about
+extern const struct hid_profile_t huion_hid_profile;
+
+#endif
@@ -11,438 +11,470 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
 
-#include <signal.h>
-#include <linux/uinput.h>
 #include <libusb-1.0/libusb.h>
 
 #include "faketabletd.h"
 #include "utilities.h"
+#include "uevent.h"
+#include "reactor.h"
+#include "device.h"
+#include "realtime.h"
+#include "registry.h"
+#include "mapping.h"
 
-#include "drivers/hs610/hs610.h"
-
-#define USE_RETURNING_CALLBACK(_cb, ...)                        \
-{                                                               \
-    VALIDATE(                                                   \
-        _cb != NULL,                                            \
-        "cannot call empty callback \"" #_cb "\""               \
-    );                                                          \
-    return _cb(__VA_ARGS__);                                    \
-}
-
-#define CLOSE_UINPUT_DEVICE(fd)                                 \
-{                                                               \
-    if(fd >= 0)                                                 \
-    {                                                           \
-        ioctl(fd, UI_DEV_DESTROY);                              \
-        close(fd);                                              \
-        fd = -1;                                                \
-    }                                                           \
-}
 
+static struct reactor_t reactor;
 static struct libusb_context *usb_context;
-static struct libusb_device  **device_list, *device;
-static struct libusb_device_handle *device_handle;
-static struct libusb_device_descriptor descriptor;
-static struct libusb_transfer *device_transfer;
+static libusb_hotplug_callback_handle hotplug_handle;
+static bool hotplug_registered;
+
+static struct device_options_t options;
+static struct device_context_t devices[FAKETABLETD_MAX_DEVICES];
 
-static volatile int pen_device, pad_device, mouse_device, keyboard_device;
+// Devices that showed up but haven't been opened yet
+static struct libusb_device *pending_devices[FAKETABLETD_MAX_DEVICES];
+static uint64_t pending_arrival_times[FAKETABLETD_MAX_DEVICES];
+static size_t pending_device_count;
 
-static size_t devices_detected;
-static uint8_t *transfer_buffer;
+// Discovery fallbacks, for when libusb has no hotplug support
+static int uevent_fd;
+static int rescan_timer;
+static bool device_rescan;
 
-static int cursor_speed;
-static bool use_virtual_cursor;
-static bool use_virtual_wheel;
+// Threaded devices let us know they are done through this
+static int device_notify_fd;
 
-// Device setup callbacks
-create_virtual_device_callback_t create_virtual_pad_callback;
-create_virtual_device_callback_t create_virtual_pen_callback;
+// Measures how long the main thread waits to get scheduled
+static struct latency_probe_t latency_probe;
 
-// Parsing callbacks
-process_raw_input_callback_t process_raw_input_callback;
+// The pressure curve the pens are using and the one the next reload goes
+// into. Whichever was replaced last is left alone until the reload after
+// that, long after any report that was still looking at it is done
+static struct pressure_table_t pressure_tables[2];
+static size_t pressure_table_index;
+static const char *config_path;
 
 REGISTER_MUTEX_VARIABLE(bool, should_close);
 REGISTER_MUTEX_VARIABLE(bool, should_reset);
 REGISTER_MUTEX_VARIABLE(bool, should_use_config);
 
-struct interface_status_t
-{
-    int number;
-    bool claimed;
-    bool detached_from_kernel;
-};
-static struct interface_status_t interface_0, interface_1;
-
-// Callback handlers
-static inline int create_virtual_pad(struct input_id *id, const char *name)
-{ USE_RETURNING_CALLBACK(create_virtual_pad_callback, id, name); }
-static inline int create_virtual_pen(struct input_id *id, const char *name)
-{ USE_RETURNING_CALLBACK(create_virtual_pen_callback, id, name); }
-
-static inline int process_raw_input(const struct raw_input_data_t *data)
-{ USE_RETURNING_CALLBACK(process_raw_input_callback, data); }
-
-// faketablet id
-static const struct input_id faketabletd_id = (const struct input_id)
-{
-    .bustype    = BUS_USB,
-    .vendor     = FAKETABLETD_VID,
-    .product    = FAKETABLETD_PID,
-    .version    = FAKETABLETD_VERSION,
-};
-static const struct input_id wacom_id = (const struct input_id)
-{
-    .bustype    = BUS_USB,
-    .vendor     = 0x056a,
-    .product    = 0x0314,
-    .version    = 0x0110,
-};
-
-// Signal handlers
-static void signal_handler(int sig)
+// Signals reach us through the reactor, so there's no need to worry
+// about async-signal-safety in here
+static void signal_callback(struct reactor_t *reactor, int signal, void *user_data)
 {
     __INFO("termination signal detected!");
-    
-    if(device_transfer != NULL)
-        libusb_cancel_transfer(device_transfer);
+
+    for(size_t i = 0; i < FAKETABLETD_MAX_DEVICES; i++)
+        if(devices[i].in_use)
+            device_request_close(&devices[i]);
 
     set_should_close(true);
     set_should_reset(false);
 }
 
-// Device name for the specified vendor and product id. Return NULL if
-// the specified device is not supported
-static const char *setup_device(uint16_t vendor_id, uint16_t product_id)
+// SIGUSR1 dumps every device's stats without stopping anything
+static void stats_signal_callback(struct reactor_t *reactor, int signal, void *user_data)
 {
-    switch (vendor_id)
+    for(size_t i = 0; i < FAKETABLETD_MAX_DEVICES; i++)
+        if(devices[i].in_use)
+            device_print_stats(&devices[i]);
+}
+
+// Compiles the curve from the pressure items into whichever table isn't
+// in use and swaps it in, or goes back to raw pressure if there's no curve
+static int load_pressure_curve()
+{
+    struct pressure_curve_t curve = (struct pressure_curve_t){ .max = PRESSURE_MAX };
+    struct pressure_table_t *table = &pressure_tables[pressure_table_index ^ 1];
+
+    if(ini_item_is_populated(INI_PRESSURE_GAMMA))
     {
-    // For HUION devices
-    case USB_VENDOR_ID_HUION:
-        {
-            switch (product_id)
-            {
-            case USB_DEVICE_ID_HUION_TABLET:
-            case USB_DEVICE_ID_HUION_HS610:
-                create_virtual_pad_callback = &generic_create_virtual_pad;
-                create_virtual_pen_callback = &generic_create_virtual_pen;
-                process_raw_input_callback = &hs610_process_raw_input;
-                return hs610_get_device_name();
-            default:
-                break;
-            }
-        }
-        break;
-    
-    default:
-        break;
+        curve.type = PRESSURE_CURVE_GAMMA;
+        curve.gamma = ini_get_item(INI_PRESSURE_GAMMA, float);
+    }
+    if(ini_item_is_populated(INI_PRESSURE_CURVE) && pressure_parse_bezier(&curve, ini_get_item(INI_PRESSURE_CURVE, const char*)) < 0)
+        return -1;
+    if(ini_item_is_populated(INI_PRESSURE_MIN))
+        curve.min = ini_get_item(INI_PRESSURE_MIN, int);
+    if(ini_item_is_populated(INI_PRESSURE_MAX))
+        curve.max = ini_get_item(INI_PRESSURE_MAX, int);
+
+    if(curve.type == PRESSURE_CURVE_NONE && curve.min == 0 && curve.max == PRESSURE_MAX)
+    {
+        pressure_publish(&options.pressure, NULL);
+        return 0;
     }
 
-    return NULL;
+    if(pressure_compile(table, &curve) < 0)
+        return -1;
+    pressure_publish(&options.pressure, table);
+    pressure_table_index ^= 1;
+
+    __INFO("using a %s pressure curve from %d to %d",
+        curve.type == PRESSURE_CURVE_GAMMA ? "gamma" : curve.type == PRESSURE_CURVE_BEZIER ? "bezier" : "linear",
+        curve.min, curve.max);
+    return 0;
 }
 
-// We use this to simulate mouse scroll events for the scroll wheel
-static int create_virtual_mouse()
+// SIGHUP reads the pressure curve from the config file again, and keeps
+// the one in use if the new one is no good. Nothing else is read again,
+// the rest of the config is still in use by the devices
+static void reload_signal_callback(struct reactor_t *reactor, int signal, void *user_data)
 {
-    int ret = 0;
-    struct uinput_setup input_setup = (struct uinput_setup){};
-
-    __STD_CATCHER_CRITICAL(
-        mouse_device = open(FAKETABLETD_UINPUT_PATH, FAKETABLETD_UINTPUT_OFLAGS),
-        "cannot open virtual mouse file"
-    );
+    if(config_path == NULL)
+    {
+        __WARNING("there's no configuration file to reload");
+        return;
+    }
 
-#define __IOCTL( ...) ret = ioctl(mouse_device, __VA_ARGS__); if(ret < 0) break;
-    do
-    {
-        // Setup mouse events, buttons, scroll wheel and movement
-        __IOCTL(UI_SET_EVBIT, EV_KEY);
-        __IOCTL(UI_SET_KEYBIT, BTN_LEFT);
-        __IOCTL(UI_SET_KEYBIT, BTN_RIGHT);
-        __IOCTL(UI_SET_KEYBIT, BTN_MIDDLE);
-        __IOCTL(UI_SET_EVBIT, EV_REL);
-        __IOCTL(UI_SET_RELBIT, REL_X);
-        __IOCTL(UI_SET_RELBIT, REL_Y);
-        __IOCTL(UI_SET_RELBIT, REL_WHEEL);
-        __IOCTL(UI_SET_RELBIT, REL_WHEEL_HI_RES);
-
-        input_setup.id.bustype = BUS_USB;
-        input_setup.id.vendor = 0x1233;
-        input_setup.id.product = FAKETABLETD_VID;
-        strcpy(input_setup.name, FAKETABLETD_NAME " Mouse");
-
-        __IOCTL(UI_DEV_SETUP, &input_setup);
-        __IOCTL(UI_DEV_CREATE);
-
-    } while (0);
-#undef __IOCTL
-    if(ret < 0)
+    if(ini_reparse_items(config_path, INI_PRESSURE_FIRST, INI_PRESSURE_LAST) < 0 || load_pressure_curve() < 0)
     {
-        close(mouse_device);
-        __STD_CATCHER_CRITICAL(ret, "error creating virtual mouse");
+        __WARNING("cannot reload the pressure curve from \"%s\", keeping the current one", config_path);
+        return;
     }
-    
-    return mouse_device;
+    __INFO("reloaded the pressure curve from \"%s\"", config_path);
 }
 
-// We use this to simulate keyboard presses
-static int create_virtual_keyboard()
+// Device name for the specified vendor and product id. Return NULL if
+// the specified device is not supported. ctx can be NULL if we only
+// want to know if the device is supported
+static const char *setup_device(uint16_t vendor_id, uint16_t product_id, struct device_context_t *ctx)
 {
-    int ret = 0;
-    struct uinput_setup input_setup = (struct uinput_setup){};
+    const struct registry_entry_t *entry = registry_lookup(vendor_id, product_id);
 
-    __STD_CATCHER_CRITICAL(
-        keyboard_device = open(FAKETABLETD_UINPUT_PATH, FAKETABLETD_UINTPUT_OFLAGS),
-        "cannot open virtual keyboard file"
-    );
+    if(entry == NULL)
+        return NULL;
 
-#define __IOCTL( ...) ret = ioctl(keyboard_device, __VA_ARGS__); if(ret < 0) break;
-    do
+    if(ctx != NULL)
     {
-        // Setup mouse events, buttons, scroll wheel and movement
-        __IOCTL(UI_SET_EVBIT, EV_KEY);
-        for(int i = KEY_RESERVED; i < KEY_F24; i++)
-        { __IOCTL(UI_SET_KEYBIT, i); }
-
-        input_setup.id.bustype = BUS_USB;
-        input_setup.id.vendor = 0x1232;
-        input_setup.id.product = FAKETABLETD_VID;
-        strcpy(input_setup.name, FAKETABLETD_NAME " Keyboard");
-
-        __IOCTL(UI_DEV_SETUP, &input_setup);
-        __IOCTL(UI_DEV_CREATE);
+        ctx->create_virtual_pad_callback = entry->profile->create_virtual_pad;
+        ctx->create_virtual_pen_callback = entry->profile->create_virtual_pen;
+        ctx->process_raw_input_callback = entry->profile->process_raw_input;
+        ctx->hid_profile = entry->profile->hid;
+        ctx->pen_ranges = entry->profile->pen_ranges;
+    }
+    return entry->name;
+}
 
-    } while (0);
-#undef __IOCTL
+static bool device_is_known(struct libusb_device *dev)
+{
+    size_t i = 0;
+    uint8_t bus_number = libusb_get_bus_number(dev), device_address = libusb_get_device_address(dev);
 
-    if(ret < 0)
+    for(i = 0; i < FAKETABLETD_MAX_DEVICES; i++)
     {
-        close(keyboard_device);
-        __STD_CATCHER_CRITICAL(ret, "error creating virtual keyboard");
+        if(devices[i].in_use && devices[i].bus_number == bus_number && devices[i].device_address == device_address)
+            return true;
     }
-    
-    return keyboard_device;
+    for(i = 0; i < pending_device_count; i++)
+    {
+        if(libusb_get_bus_number(pending_devices[i]) == bus_number && libusb_get_device_address(pending_devices[i]) == device_address)
+            return true;
+    }
+
+    return false;
 }
 
-static void claim_interface_for_handle(struct libusb_device_handle *handle, struct interface_status_t *interface)
+// Remember a supported device so it can be opened once we're out of
+// libusb's event handling
+static void queue_device(struct libusb_device *dev, uint64_t arrival_time)
 {
     int ret = 0;
-    // Detach interface from the kernel and claim it for ourselves
-    if(libusb_kernel_driver_active(handle, interface->number) == 1)
+    struct libusb_device_descriptor descriptor = (struct libusb_device_descriptor){};
+
+    __USB_CATCHER(ret = libusb_get_device_descriptor(dev, &descriptor), "cannot get device descriptor");
+    if(ret < 0 || setup_device(descriptor.idVendor, descriptor.idProduct, NULL) == NULL)
+        return;
+
+    if(device_is_known(dev))
+        return;
+
+    if(pending_device_count >= FAKETABLETD_MAX_DEVICES)
     {
-        ret  = libusb_detach_kernel_driver(handle, interface->number);
-        if(ret < 0 && ret != LIBUSB_ERROR_NOT_FOUND)
-            __USB_CATCHER_CRITICAL(ret, "cannot detach kernel from interface %d", interface->number);
-        interface->detached_from_kernel = true;
+        __WARNING("too many devices waiting to be opened, ignoring %04x:%04x", descriptor.idVendor, descriptor.idProduct);
+        return;
     }
-    else
-        interface->detached_from_kernel = false;
 
-    __CATCHER_CRITICAL(libusb_claim_interface(handle, interface->number), "cannot claim interface %d", interface->number);
-    interface->claimed = true;
+    pending_arrival_times[pending_device_count] = arrival_time;
+    pending_devices[pending_device_count++] = libusb_ref_device(dev);
+}
 
-    // This part is a little trickier to understand. Basically, we are going to setup the
-    // handle to work with a HID device on this interface. You can actually understand a lot
-    // of what's going on by reading this spec
-    // https://www.usb.org/sites/default/files/hid1_11.pdf
-    
-    // Set the device's protocol to report
-    __USB_CATCHER_CRITICAL(libusb_control_transfer(
-        handle, 
-        HID_SET_REQUEST_TYPE, 
-        HID_SET_PROTOCOL, 
-        HID_SET_PROTOCOL_REPORT,
-        interface->number,
-        NULL, 0,
-        HID_TIMEOUT
-    ), "cannot set protocol on interface %d", interface->number);
+static void look_for_devices()
+{
+    ssize_t i = 0, count = 0;
+    struct libusb_device **list = NULL;
+    uint64_t now = get_time_ns();
+
+    // Get device list
+    __USB_CATCHER(
+        count = libusb_get_device_list(usb_context, &list), 
+        "cannot retreive connected devices"
+    );
+
+    // Find compatible devices
+    for(i = 0; i < count; i++)
+        queue_device(list[i], now);
     
-    // Make sure idle is set to infinity
-    __USB_CATCHER_CRITICAL(libusb_control_transfer(
-        handle, 
-        HID_SET_REQUEST_TYPE, 
-        HID_SET_IDLE, 
-
-        // This makes sure the 8th bit of the word (wValue) is 0, 
-        // making the idle duration undefined (it's on the pdf too)
-        0 << 8,
-        
-        interface->number,
-        NULL, 0,
-        HID_TIMEOUT
-    ), "cannot set protocol on interface %d", interface->number);
+    if(list != NULL)
+        libusb_free_device_list(list, true);
 }
 
-static void interrupt_transfer_callback(struct libusb_transfer *transfer)
+static int LIBUSB_CALL hotplug_callback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+    if(event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+        queue_device(dev, get_time_ns());
+    return 0;
+}
+
+static void uevent_callback(struct reactor_t *reactor, int fd, uint32_t events, void *user_data)
 {
     int ret = 0;
-    bool terminate = true;
-    struct raw_input_data_t raw_input_data;
-    if(transfer == NULL || get_should_close()) return;
-
-#ifndef NDEBUG
-    __INFO("report: ");
-    for(size_t s = 0; s < transfer->actual_length; s++)
-        printf("%02X ", transfer->buffer[s]);
-    printf("\n");
-#endif
-    
-    switch (transfer->status)
+    uint16_t vendor_id = 0, product_id = 0;
+
+    while((ret = uevent_read_usb_add(fd, &vendor_id, &product_id)) > 0)
     {
-    case LIBUSB_TRANSFER_COMPLETED:
-        raw_input_data = (struct raw_input_data_t){
-            .data = transfer->buffer,
-            .size = transfer->actual_length,
+        if(setup_device(vendor_id, product_id, NULL) != NULL)
+            device_rescan = true;
+    }
 
-            .pad_device = pad_device,
-            .pen_device = pen_device,
+    // We might have missed something (ENOBUFS), so take a look ourselves
+    if(ret < 0)
+    {
+        __WARNING("cannot read kernel uevent: %s", strerror(errno));
+        device_rescan = true;
+    }
+}
 
-            .mouse_device = mouse_device,
-            .keyboard_device = keyboard_device,
+static void rescan_timer_callback(struct reactor_t *reactor, uint64_t expirations, void *user_data)
+{
+    device_rescan = true;
+}
 
-            .cursor_speed = cursor_speed,
+// Let libusb tell us when a device shows up. Already connected devices are
+// reported right away thanks to LIBUSB_HOTPLUG_ENUMERATE. Without hotplug
+// support, listen for kernel uevents and only rescan the bus when a supported
+// device is added. If even that fails, fall back to rescanning every
+// DEVICE_POLL_INTERVAL_US
+static void start_discovery()
+{
+    if(libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+    {
+        __USB_CATCHER_CRITICAL(
+            libusb_hotplug_register_callback(
+                usb_context, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, LIBUSB_HOTPLUG_ENUMERATE,
+                LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+                hotplug_callback, NULL, &hotplug_handle
+            ),
+            "cannot register hotplug callback"
+        );
+        hotplug_registered = true;
+        return;
+    }
 
-            .use_virtual_cursor = use_virtual_cursor,
-            .use_virtual_wheel = use_virtual_wheel,
+    if((uevent_fd = uevent_open()) < 0 || reactor_add_fd(&reactor, uevent_fd, EPOLLIN, uevent_callback, NULL) < 0)
+    {
+        __WARNING("cannot listen for kernel uevents, falling back to polling");
+        uevent_close(uevent_fd);
+        uevent_fd = -1;
 
-            .config_available = get_should_use_config()
-        };
-        ret = process_raw_input(&raw_input_data);
-        if(!(terminate = ret < 0))
-        {
-            __USB_CATCHER(ret = libusb_submit_transfer(transfer), "cannot resubmit event transfer");
-            terminate = ret < 0;
-        }
-        break;
-    
-    // Taken from https://github.com/DIGImend/digimend-userspace-drivers/blob/main/src/dud-translate.c
-#define MAP(_name, _desc)                       \
-    case LIBUSB_TRANSFER_##_name:               \
-        __ERROR(_desc);                         \
-        break
-
-        MAP(ERROR,      "interrupt transfer failed");
-        MAP(TIMED_OUT,  "interrupt transfer timed out");
-        MAP(STALL,      "interrupt transfer halted (endpoint stalled)");
-        MAP(OVERFLOW,   "interrupt transfer overflowed "
-                        "(device sent more data than requested)");
-#undef MAP
-
-    case LIBUSB_TRANSFER_NO_DEVICE:
-        __INFO("device has been disconnected!");
-        break;
-
-    case LIBUSB_TRANSFER_CANCELLED:
-        break;
-    
-    default:
-        __ERROR("Uknown transfer error: %d", transfer->status);
-        break;
+        rescan_timer = reactor_add_timer(
+            &reactor, DEVICE_POLL_INTERVAL_US * 1000ULL, DEVICE_POLL_INTERVAL_US * 1000ULL, 
+            rescan_timer_callback, NULL
+        );
+        __CATCHER_CRITICAL(rescan_timer, "cannot create rescan timer");
     }
-
-    if(terminate)
-        set_should_close(true);
+    device_rescan = true;
 }
 
-// Free allocated objects and deinitialize libusb
-static void cleannup(void)
+static void stop_discovery()
 {
-    devices_detected = 0;
-
-    set_should_close(false);
-
-    CLOSE_UINPUT_DEVICE(keyboard_device);
-    CLOSE_UINPUT_DEVICE(mouse_device);
-    CLOSE_UINPUT_DEVICE(pen_device);
-    CLOSE_UINPUT_DEVICE(pad_device);
+    if(hotplug_registered)
+    {
+        libusb_hotplug_deregister_callback(usb_context, hotplug_handle);
+        hotplug_registered = false;
+    }
 
-    if(device_transfer != NULL)
+    if(uevent_fd >= 0)
     {
-        libusb_free_transfer(device_transfer);
-        device_transfer = NULL;
+        reactor_remove_fd(&reactor, uevent_fd);
+        uevent_close(uevent_fd);
+        uevent_fd = -1;
     }
 
-    if(transfer_buffer != NULL)
+    if(rescan_timer >= 0)
     {
-        free(transfer_buffer);
-        transfer_buffer = NULL;
+        reactor_remove_fd(&reactor, rescan_timer);
+        rescan_timer = -1;
     }
+}
 
-    if(interface_0.claimed)
+static void open_pending_devices()
+{
+    int ret = 0;
+    size_t i = 0, slot = 0;
+    struct device_context_t *ctx = NULL;
+    struct libusb_device *dev = NULL;
+
+    if(device_rescan)
     {
-        libusb_release_interface(device_handle, interface_0.number);
-        interface_0.claimed = false;
+        device_rescan = false;
+        look_for_devices();
     }
-    if(interface_1.claimed)
+
+    for(i = 0; i < pending_device_count; i++)
     {
-        libusb_release_interface(device_handle, interface_1.number);
-        interface_1.claimed = false;
+        dev = pending_devices[i];
+        pending_devices[i] = NULL;
+
+        for(slot = 0, ctx = NULL; slot < FAKETABLETD_MAX_DEVICES && ctx == NULL; slot++)
+            if(!devices[slot].in_use) ctx = &devices[slot];
+
+        if(ctx == NULL)
+        {
+            __WARNING("cannot serve more than %d devices at once", FAKETABLETD_MAX_DEVICES);
+            libusb_unref_device(dev);
+            continue;
+        }
+
+        ctx->in_use = true;
+        ctx->index = (int)(ctx - devices);
+        ctx->arrival_time = pending_arrival_times[i];
+        libusb_get_device_descriptor(dev, &ctx->descriptor);
+        ctx->name = setup_device(ctx->descriptor.idVendor, ctx->descriptor.idProduct, ctx);
+
+        // Let us know what you've found
+        __INFO("found supported device: %s (%04x:%04x)", ctx->name, ctx->descriptor.idVendor, ctx->descriptor.idProduct);
+
+        ret = device_open(ctx, dev, &options, &reactor, device_notify_fd);
+        libusb_unref_device(dev);
+
+        if(ret < 0)
+        {
+            if(ret == LIBUSB_ERROR_ACCESS)
+            {
+                __WARNING("you need to be running as root in order to use this software");
+                exit(1);
+            }
+
+            device_close(ctx);
+            continue;
+        }
+
+        __INFO(
+            "[%s #%d] ready! (%.2f ms after the device showed up)", 
+            ctx->name, ctx->index, (get_time_ns() - ctx->arrival_time) / 1e6
+        );
     }
+    pending_device_count = 0;
+}
 
-    // if(interface_1.detached_from_kernel)
-    // {
-    //     libusb_attach_kernel_driver(device_handle, interface_1.number);
-    //     interface_1.detached_from_kernel = false;
-    // }
-    // if(interface_0.detached_from_kernel)
-    // {
-    //     libusb_attach_kernel_driver(device_handle, interface_0.number);
-    //     interface_0.detached_from_kernel = false;
-    // }
+// Replays don't need any USB device, so the driver is picked as if the
+// tablet the capture came from had just shown up. Other dumps don't say,
+// so those are taken to come from an HS610
+static int open_replay_device()
+{
+    struct device_context_t *ctx = &devices[0];
+    uint16_t vendor_id = USB_VENDOR_ID_HUION, product_id = USB_DEVICE_ID_HUION_HS610;
 
-    if(device_handle != NULL)
+    report_file_read_ids(options.replay_path, &vendor_id, &product_id);
+    if(setup_device(vendor_id, product_id, NULL) == NULL)
     {
-        libusb_close(device_handle);
-        device_handle = NULL;
-        device = NULL;
+        __ERROR("no driver for %04x:%04x, which \"%s\" was captured from", vendor_id, product_id, options.replay_path);
+        return -1;
     }
 
-    if(device_list != NULL)
+    ctx->in_use = true;
+    ctx->index = 0;
+    ctx->arrival_time = get_time_ns();
+    ctx->descriptor = (struct libusb_device_descriptor){
+        .idVendor = vendor_id,
+        .idProduct = product_id,
+    };
+    ctx->name = setup_device(ctx->descriptor.idVendor, ctx->descriptor.idProduct, ctx);
+
+    if(device_open(ctx, NULL, &options, &reactor, device_notify_fd) < 0)
     {
-        libusb_free_device_list(device_list, true);
-        device_list = NULL;
+        device_close(ctx);
+        return -1;
     }
 
-    if(usb_context != NULL)
+    return 0;
+}
+
+static size_t open_device_count()
+{
+    size_t count = 0;
+
+    for(size_t i = 0; i < FAKETABLETD_MAX_DEVICES; i++)
+        count += devices[i].in_use;
+    return count;
+}
+
+// Release devices that are done. Returns how many of them were closed
+static size_t close_finished_devices()
+{
+    size_t closed = 0;
+
+    for(size_t i = 0; i < FAKETABLETD_MAX_DEVICES; i++)
     {
-        libusb_exit(usb_context);
-        usb_context = NULL;
+        if(!devices[i].in_use || !device_is_finished(&devices[i]))
+            continue;
+
+        device_close(&devices[i]);
+        closed++;
     }
 
-    create_virtual_pad_callback = NULL;
-    create_virtual_pen_callback = NULL;
-    process_raw_input_callback = NULL;
+    return closed;
 }
 
-static bool look_for_devices(const char **device_name)
+static void device_notify_callback(struct reactor_t *reactor, int fd, uint32_t events, void *user_data)
+{
+    uint64_t value = 0;
+    if(read(fd, &value, sizeof(value)) < 0) return;
+}
+
+// Free allocated objects and deinitialize libusb
+static void cleannup(void)
 {
     size_t i = 0;
-    struct libusb_device* dev = NULL;
-    devices_detected = 0;
 
-    if(device_list != NULL) libusb_free_device_list(device_list, true);
+    for(i = 0; i < FAKETABLETD_MAX_DEVICES; i++)
+    {
+        if(!devices[i].in_use) continue;
 
-    // Get device list
-    __USB_CATCHER_CRITICAL(
-        devices_detected = libusb_get_device_list(usb_context, &device_list), 
-        "cannot retreive connected devices"
-    );
+        // Give non threaded devices a chance to get their transfers back
+        device_request_close(&devices[i]);
+        while(!device_is_finished(&devices[i]) && reactor_run_once(&reactor, HID_TIMEOUT) > 0);
+        device_close(&devices[i]);
+    }
 
-    // Find compatible devices
-    for(i = 0; i < devices_detected; i++)
+    for(i = 0; i < pending_device_count; i++)
+        libusb_unref_device(pending_devices[i]);
+    pending_device_count = 0;
+
+    stop_discovery();
+
+    if(latency_probe.timer >= 0)
     {
-        dev = device_list[i];
+        latency_probe_print(&latency_probe, "event thread");
+        latency_probe_stop(&latency_probe, &reactor);
+    }
 
-        // See if current device on the list is supported
-        __USB_CATCHER(libusb_get_device_descriptor(dev, &descriptor), "cannot get device descriptor");
-        if((*device_name = setup_device(descriptor.idVendor, descriptor.idProduct)) != NULL)
-        {
-            device = dev;
-            return true;
-        }
+    if(device_notify_fd >= 0)
+    {
+        reactor_remove_fd(&reactor, device_notify_fd);
+        close(device_notify_fd);
+        device_notify_fd = -1;
+    }
+
+    if(usb_context != NULL)
+    {
+        reactor_detach_usb(&reactor);
+        libusb_exit(usb_context);
+        usb_context = NULL;
     }
-    
-    return false;
 }
 
 static const char *get_home_config_file()
@@ -455,7 +487,7 @@ static const char *get_home_config_file()
 
 static void read_config()
 {
-    int i = 0;
+    int i = 0, ret = 0;
     char label[INI_STRING_SIZE] = {0};
     const char *str = NULL;
 
@@ -472,6 +504,87 @@ static void read_config()
     snprintf(label, INI_STRING_SIZE, "cursor_speed");
     ini_register_item(INI_CURSOR_SPEED, INI_TYPE_INT, label);
 
+    snprintf(label, INI_STRING_SIZE, "transfer_count");
+    ini_register_item(INI_TRANSFER_COUNT, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "device_threads");
+    ini_register_item(INI_DEVICE_THREADS, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "thread_cpus");
+    ini_register_item(INI_THREAD_CPUS, INI_TYPE_STRING, label);
+
+    snprintf(label, INI_STRING_SIZE, "pipeline");
+    ini_register_item(INI_PIPELINE, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "realtime");
+    ini_register_item(INI_REALTIME, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "realtime_priority");
+    ini_register_item(INI_REALTIME_PRIORITY, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "realtime_policy");
+    ini_register_item(INI_REALTIME_POLICY, INI_TYPE_STRING, label);
+
+    snprintf(label, INI_STRING_SIZE, "realtime_cpus");
+    ini_register_item(INI_REALTIME_CPUS, INI_TYPE_STRING, label);
+
+    snprintf(label, INI_STRING_SIZE, "latency_probe");
+    ini_register_item(INI_LATENCY_PROBE, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "hidraw");
+    ini_register_item(INI_HIDRAW, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "io_uring");
+    ini_register_item(INI_IO_URING, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "sink");
+    ini_register_item(INI_SINK, INI_TYPE_STRING, label);
+
+    snprintf(label, INI_STRING_SIZE, "area_x");
+    ini_register_item(INI_AREA_X, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "area_y");
+    ini_register_item(INI_AREA_Y, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "area_width");
+    ini_register_item(INI_AREA_WIDTH, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "area_height");
+    ini_register_item(INI_AREA_HEIGHT, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "rotation");
+    ini_register_item(INI_ROTATION, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "keep_aspect");
+    ini_register_item(INI_KEEP_ASPECT, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "smoothing");
+    ini_register_item(INI_SMOOTHING, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "smoothing_cutoff");
+    ini_register_item(INI_SMOOTHING_CUTOFF, INI_TYPE_FLOAT, label);
+
+    snprintf(label, INI_STRING_SIZE, "smoothing_beta");
+    ini_register_item(INI_SMOOTHING_BETA, INI_TYPE_FLOAT, label);
+
+    snprintf(label, INI_STRING_SIZE, "pressure_beta");
+    ini_register_item(INI_PRESSURE_BETA, INI_TYPE_FLOAT, label);
+
+    snprintf(label, INI_STRING_SIZE, "prediction");
+    ini_register_item(INI_PREDICTION, INI_TYPE_FLOAT, label);
+
+    snprintf(label, INI_STRING_SIZE, "pressure_gamma");
+    ini_register_item(INI_PRESSURE_GAMMA, INI_TYPE_FLOAT, label);
+
+    snprintf(label, INI_STRING_SIZE, "pressure_curve");
+    ini_register_item(INI_PRESSURE_CURVE, INI_TYPE_STRING, label);
+
+    snprintf(label, INI_STRING_SIZE, "pressure_min");
+    ini_register_item(INI_PRESSURE_MIN, INI_TYPE_INT, label);
+
+    snprintf(label, INI_STRING_SIZE, "pressure_max");
+    ini_register_item(INI_PRESSURE_MAX, INI_TYPE_INT, label);
+
     // Look for a directory where a config file might be, and parse it if you found it
     str = get_home_config_file();
     const char *config_paths[] = { str, ETC_CONFIG_PATH };
@@ -479,20 +592,126 @@ static void read_config()
         return;
     
     __INFO("detected configuration file on \"%s\"", str);
+    config_path = str;
     set_should_use_config(false);
     __CATCHER_CRITICAL(ini_parse_file(str), "cannot parse file \"%s\"", str);
     __INFO("loaded configuration from \"%s\" successfuly", str);
 
-    for(i = INI_BUTTON_1_INDEX; i < INI_BUTTON_MAX; i++)
+    // INI_BUTTON_MAX takes cursor_speed in, which is no binding
+    for(i = INI_BUTTON_1_INDEX; i < INI_CURSOR_SPEED; i++)
     {
         if(!ini_item_is_populated(i)) continue;
 
         str = ini_get_item(i, const char*);
+        __CATCHER_CRITICAL(strlen(str) > INI_STRING_SIZE ? -1 : 0, "binding \"%s\" is longer than %d keys", str, INI_STRING_SIZE);
         __CATCHER_CRITICAL(validate_key_presses(str), "invalid binding on a config file \"%s\"", str);
     }
 
     if(ini_item_is_populated(INI_CURSOR_SPEED))
-        cursor_speed = ini_get_item(INI_CURSOR_SPEED, int);
+        options.cursor_speed = ini_get_item(INI_CURSOR_SPEED, int);
+
+    // Command line takes precedence over the config file
+    if(ini_item_is_populated(INI_TRANSFER_COUNT) && options.transfer_count == 0)
+        options.transfer_count = ini_get_item(INI_TRANSFER_COUNT, int);
+
+    if(ini_item_is_populated(INI_DEVICE_THREADS) && ini_get_item(INI_DEVICE_THREADS, int) != 0)
+        options.use_threads = true;
+
+    if(ini_item_is_populated(INI_THREAD_CPUS) && options.thread_cpu_count == 0)
+    {
+        str = ini_get_item(INI_THREAD_CPUS, const char*);
+        __CATCHER_CRITICAL(
+            ret = parse_cpu_list(str, options.thread_cpus, FAKETABLETD_MAX_CPUS),
+            "invalid cpu list \"%s\"", str
+        );
+        options.thread_cpu_count = ret;
+    }
+
+    if(ini_item_is_populated(INI_PIPELINE) && ini_get_item(INI_PIPELINE, int) != 0)
+        options.use_pipeline = true;
+
+    if(ini_item_is_populated(INI_REALTIME) && ini_get_item(INI_REALTIME, int) != 0)
+        options.realtime.enabled = true;
+
+    if(ini_item_is_populated(INI_REALTIME_PRIORITY) && options.realtime.priority == 0)
+        options.realtime.priority = ini_get_item(INI_REALTIME_PRIORITY, int);
+
+    if(ini_item_is_populated(INI_REALTIME_POLICY) && options.realtime.policy < 0)
+    {
+        str = ini_get_item(INI_REALTIME_POLICY, const char*);
+        __CATCHER_CRITICAL(
+            options.realtime.policy = realtime_parse_policy(str),
+            "invalid scheduling policy \"%s\"", str
+        );
+    }
+
+    if(ini_item_is_populated(INI_REALTIME_CPUS) && options.realtime.cpu_count == 0)
+    {
+        str = ini_get_item(INI_REALTIME_CPUS, const char*);
+        __CATCHER_CRITICAL(
+            ret = parse_cpu_list(str, options.realtime.cpus, REALTIME_MAX_CPUS),
+            "invalid cpu list \"%s\"", str
+        );
+        options.realtime.cpu_count = ret;
+    }
+
+    if(ini_item_is_populated(INI_LATENCY_PROBE) && ini_get_item(INI_LATENCY_PROBE, int) != 0)
+        options.realtime.probe = true;
+
+    if(ini_item_is_populated(INI_HIDRAW) && ini_get_item(INI_HIDRAW, int) != 0)
+        options.use_hidraw = true;
+
+    if(ini_item_is_populated(INI_IO_URING) && ini_get_item(INI_IO_URING, int) != 0)
+        options.use_io_uring = true;
+
+    if(ini_item_is_populated(INI_SINK) && options.sink == NULL)
+    {
+        str = ini_get_item(INI_SINK, const char*);
+        __CATCHER_CRITICAL((options.sink = sink_find(str)) != NULL ? 0 : -1, "invalid sink \"%s\"", str);
+    }
+
+    // Whether the area fits is only known once we know the tablet
+    if(ini_item_is_populated(INI_AREA_X))
+        options.mapping.area_x = ini_get_item(INI_AREA_X, int);
+    if(ini_item_is_populated(INI_AREA_Y))
+        options.mapping.area_y = ini_get_item(INI_AREA_Y, int);
+    if(ini_item_is_populated(INI_AREA_WIDTH))
+        options.mapping.area_width = ini_get_item(INI_AREA_WIDTH, int);
+    if(ini_item_is_populated(INI_AREA_HEIGHT))
+        options.mapping.area_height = ini_get_item(INI_AREA_HEIGHT, int);
+
+    if(ini_item_is_populated(INI_ROTATION))
+    {
+        options.mapping.rotation = ini_get_item(INI_ROTATION, int);
+        __CATCHER_CRITICAL(
+            mapping_rotation_is_valid(options.mapping.rotation) ? 0 : -1,
+            "invalid rotation %d, it can only be 0, 90, 180 or 270", options.mapping.rotation
+        );
+    }
+
+    if(ini_item_is_populated(INI_KEEP_ASPECT) && ini_get_item(INI_KEEP_ASPECT, int) != 0)
+        options.mapping.keep_aspect = true;
+
+    if(ini_item_is_populated(INI_SMOOTHING) && ini_get_item(INI_SMOOTHING, int) != 0)
+    {
+        __CATCHER_CRITICAL(
+            filter_setup(&options.filter,
+                ini_item_is_populated(INI_SMOOTHING_CUTOFF) ? ini_get_item(INI_SMOOTHING_CUTOFF, float) : FILTER_DEFAULT_CUTOFF,
+                ini_item_is_populated(INI_SMOOTHING_BETA) ? ini_get_item(INI_SMOOTHING_BETA, float) : FILTER_DEFAULT_BETA,
+                ini_item_is_populated(INI_PRESSURE_BETA) ? ini_get_item(INI_PRESSURE_BETA, float) : FILTER_DEFAULT_PRESSURE_BETA
+            ),
+            "invalid smoothing settings"
+        );
+        options.use_smoothing = true;
+    }
+
+    if(ini_item_is_populated(INI_PREDICTION) && ini_get_item(INI_PREDICTION, float) > 0)
+    {
+        __CATCHER_CRITICAL(predict_setup(&options.predict, ini_get_item(INI_PREDICTION, float)), "invalid prediction settings");
+        options.use_prediction = true;
+    }
+
+    __CATCHER_CRITICAL(load_pressure_curve(), "invalid pressure curve");
     
     set_should_use_config(true);
 }
@@ -508,11 +727,28 @@ static inline void print_help()
         "  -c\t\t\tEnables virtual mouse cursor emulation\n"
         "  -s\t\t\tEnables virtual mouse scrolling wheel emulation\n"
         "  -k\t\t\tEnables virtual keyboard emulation\n"
-        "  -r\t\t\tResets the program back to the scanning phase on disconnect (experimental)\n\n"
+        "  -t COUNT\t\tNumber of interrupt transfers kept queued on the device (default: %d, max: %d)\n"
+        "  -j\t\t\tServices each tablet from its own thread\n"
+        "  -p CPUS\t\tPins device threads to the given cpus, i.e. 2,3 or 2-3 (implies -j)\n"
+        "  -q\t\t\tTranslates reports on a separate thread, so USB transfers are resubmitted right away\n"
+        "  -r\t\t\tResets the program back to the scanning phase on disconnect (experimental)\n"
+        "  --realtime\t\tRuns the event handling threads under a realtime policy with their memory locked\n"
+        "  --realtime-priority N\tRealtime priority to use (default: %d)\n"
+        "  --realtime-policy P\tEither fifo or rr (default: fifo)\n"
+        "  --realtime-cpus CPUS\tPins the event handling threads to the given cpus\n"
+        "  --latency-probe\tMeasures scheduling latency and prints it on exit (implied by --realtime)\n"
+        "  --hidraw\t\tReads reports from the kernel's hidraw node instead of claiming the device\n"
+        "  --replay FILE\t\tPlays back reports captured with usbhid-dump (or raw ones) instead of using a device\n"
+        "  --replay-timing\tKeeps the time between reports as captured, instead of going as fast as possible\n"
+        "  --replay-report-size N\tSize of each report on raw captures (default: %d)\n"
+        "  --capture FILE\t\tRecords every report into FILE (see capture.h for the format)\n"
+        "  --io-uring\t\tWrites events to the virtual devices through io_uring (falls back to write if unavailable)\n"
+        "  --sink SINK\t\tWhere events go: uinput, null, memory or counting (default: uinput)\n\n"
 
         "Examples:\n"
         "  faketabletd -m\tRuns driver with virtual mouse emulation\n"
-        "  faketabletd -mr\tRuns driver with virtual mouse emulation. Will no exit on disconnect\n"
+        "  faketabletd -mr\tRuns driver with virtual mouse emulation. Will no exit on disconnect\n",
+        HID_TRANSFER_COUNT, HID_MAX_TRANSFERS, REALTIME_DEFAULT_PRIORITY, REPORT_FILE_RAW_SIZE
     );
 }
 
@@ -520,61 +756,157 @@ int main(int argc, char const **argv)
 {
     // Local variables
     int ret = 0;
-    bool 
-        use_virtual_mouse = false, 
-        use_virtual_keyboard = false,
-        use_wacom = false;
-    unsigned char descriptor_string[50] = {};
-    struct input_id *input_id;
+    const int termination_signals[] = { SIGINT, SIGTERM };
+    const int stats_signals[] = { SIGUSR1 };
+    const int reload_signals[] = { SIGHUP };
+
+    // Long options only, everything else keeps its short flag
+    enum
+    {
+        OPTION_REALTIME = 0x100,
+        OPTION_REALTIME_PRIORITY,
+        OPTION_REALTIME_POLICY,
+        OPTION_REALTIME_CPUS,
+        OPTION_LATENCY_PROBE,
+        OPTION_HIDRAW,
+        OPTION_REPLAY,
+        OPTION_REPLAY_TIMING,
+        OPTION_REPLAY_REPORT_SIZE,
+        OPTION_CAPTURE,
+        OPTION_IO_URING,
+        OPTION_SINK,
+    };
+    const struct option long_options[] = {
+        { "realtime",           no_argument,        NULL, OPTION_REALTIME },
+        { "realtime-priority",  required_argument,  NULL, OPTION_REALTIME_PRIORITY },
+        { "realtime-policy",    required_argument,  NULL, OPTION_REALTIME_POLICY },
+        { "realtime-cpus",      required_argument,  NULL, OPTION_REALTIME_CPUS },
+        { "latency-probe",      no_argument,        NULL, OPTION_LATENCY_PROBE },
+        { "hidraw",             no_argument,        NULL, OPTION_HIDRAW },
+        { "replay",             required_argument,  NULL, OPTION_REPLAY },
+        { "replay-timing",      no_argument,        NULL, OPTION_REPLAY_TIMING },
+        { "replay-report-size", required_argument,  NULL, OPTION_REPLAY_REPORT_SIZE },
+        { "capture",            required_argument,  NULL, OPTION_CAPTURE },
+        { "io-uring",           no_argument,        NULL, OPTION_IO_URING },
+        { "sink",               required_argument,  NULL, OPTION_SINK },
+        { "help",               no_argument,        NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
 
     // Initialize locals
     usb_context         = NULL;
-    device_list         = NULL;
-    device              = NULL;
-    device_handle       = NULL;
-    device_transfer     = NULL;
-    transfer_buffer     = NULL;
-
-    create_virtual_pad_callback = NULL;
-    create_virtual_pen_callback = NULL;
-    process_raw_input_callback = NULL;
-
-    pen_device          = -1;
-    pad_device          = -1;
-    mouse_device        = -1;
-
-    cursor_speed        = DEFAULT_CURSOR_SPEED;
-
-    descriptor = (struct libusb_device_descriptor){};
+    uevent_fd           = -1;
+    rescan_timer        = -1;
+    device_notify_fd    = -1;
+    latency_probe       = (struct latency_probe_t){ .timer = -1 };
+    config_path         = NULL;
+
+    options = (struct device_options_t){
+        .cursor_speed = DEFAULT_CURSOR_SPEED,
+        .realtime = { .policy = -1 },
+        .replay_report_size = REPORT_FILE_RAW_SIZE,
+    };
 
     should_close = false;
     should_reset = false;
 
-    const char* device_name = NULL;
+    __CATCHER_CRITICAL(reactor_init(&reactor), "cannot create event loop");
 
-    // Make sure we catch Ctrl-C when asked to terminate
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    // Make sure we catch Ctrl-C when asked to terminate. This has to happen
+    // before libusb or the devices start any of their threads so they don't
+    // get the signals
+    __CATCHER_CRITICAL(
+        reactor_add_signals(&reactor, termination_signals, GET_LEN(termination_signals), signal_callback, NULL),
+        "cannot listen for termination signals"
+    );
+    __CATCHER_CRITICAL(
+        reactor_add_signals(&reactor, stats_signals, GET_LEN(stats_signals), stats_signal_callback, NULL),
+        "cannot listen for stats signals"
+    );
+    __CATCHER_CRITICAL(
+        reactor_add_signals(&reactor, reload_signals, GET_LEN(reload_signals), reload_signal_callback, NULL),
+        "cannot listen for reload signals"
+    );
 
     // Make sure we clean our mess before we leave
     atexit(cleannup);
 
     // Get argument options
-    while((ret = getopt(argc, (char* const*)argv, "scrhkw")) != -1)
+    while((ret = getopt_long(argc, (char* const*)argv, "scrhkwt:jp:q", long_options, NULL)) != -1)
     {
         switch (ret)
         {
         case 'w':
-            use_wacom = true;
+            options.use_wacom = true;
             break;
         case 's':
-            use_virtual_wheel = true;
+            options.use_virtual_wheel = true;
             break;
         case 'c':
-            use_virtual_cursor = true;
+            options.use_virtual_cursor = true;
             break;
         case 'k':
-            use_virtual_keyboard = true;
+            options.use_virtual_keyboard = true;
+            break;
+        case 't':
+            options.transfer_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            options.use_threads = true;
+            break;
+        case 'q':
+            options.use_pipeline = true;
+            break;
+        case 'p':
+            __CATCHER_CRITICAL(
+                ret = parse_cpu_list(optarg, options.thread_cpus, FAKETABLETD_MAX_CPUS),
+                "invalid cpu list \"%s\"", optarg
+            );
+            options.thread_cpu_count = ret;
+            options.use_threads = true;
+            break;
+        case OPTION_REALTIME:
+            options.realtime.enabled = true;
+            break;
+        case OPTION_REALTIME_PRIORITY:
+            options.realtime.priority = strtol(optarg, NULL, 10);
+            break;
+        case OPTION_REALTIME_POLICY:
+            __CATCHER_CRITICAL(
+                options.realtime.policy = realtime_parse_policy(optarg),
+                "invalid scheduling policy \"%s\"", optarg
+            );
+            break;
+        case OPTION_REALTIME_CPUS:
+            __CATCHER_CRITICAL(
+                ret = parse_cpu_list(optarg, options.realtime.cpus, REALTIME_MAX_CPUS),
+                "invalid cpu list \"%s\"", optarg
+            );
+            options.realtime.cpu_count = ret;
+            break;
+        case OPTION_LATENCY_PROBE:
+            options.realtime.probe = true;
+            break;
+        case OPTION_HIDRAW:
+            options.use_hidraw = true;
+            break;
+        case OPTION_REPLAY:
+            options.replay_path = optarg;
+            break;
+        case OPTION_REPLAY_TIMING:
+            options.replay_timing = true;
+            break;
+        case OPTION_REPLAY_REPORT_SIZE:
+            options.replay_report_size = strtoul(optarg, NULL, 10);
+            break;
+        case OPTION_CAPTURE:
+            options.capture_path = optarg;
+            break;
+        case OPTION_IO_URING:
+            options.use_io_uring = true;
+            break;
+        case OPTION_SINK:
+            __CATCHER_CRITICAL((options.sink = sink_find(optarg)) != NULL ? 0 : -1, "invalid sink \"%s\"", optarg);
             break;
         case 'r':
             set_should_reset(true);
@@ -590,107 +922,76 @@ int main(int argc, char const **argv)
             break;
         }
     }
-    use_virtual_mouse = use_virtual_cursor || use_virtual_wheel;
+    options.use_virtual_mouse = options.use_virtual_cursor || options.use_virtual_wheel;
 
     // Read config from config file
     read_config();
 
-    while(1)
-    {
-        // Make sure we are clear to go on every cycle
-        cleannup();
+    registry_init();
+    if((ret = registry_load_file(REGISTRY_CONFIG_PATH)) >= 0)
+        __INFO("loaded %d extra devices from \"%s\"", ret, REGISTRY_CONFIG_PATH);
+    options.config_available = get_should_use_config();
 
+    if(options.transfer_count == 0)
+        options.transfer_count = HID_TRANSFER_COUNT;
+    VALIDATE(
+        options.transfer_count <= HID_MAX_TRANSFERS, 
+        "cannot queue more than %d transfers", HID_MAX_TRANSFERS
+    );
+
+    if(options.realtime.policy < 0)
+        options.realtime.policy = REALTIME_DEFAULT_POLICY;
+    if(options.realtime.priority == 0)
+        options.realtime.priority = REALTIME_DEFAULT_PRIORITY;
+    VALIDATE(
+        options.realtime.priority >= sched_get_priority_min(options.realtime.policy) &&
+        options.realtime.priority <= sched_get_priority_max(options.realtime.policy),
+        "invalid realtime priority %d", options.realtime.priority
+    );
+    options.realtime.probe |= options.realtime.enabled;
+
+    // Has to happen before libusb or the devices start any of their threads,
+    // so they get to inherit the same policy
+    realtime_setup_process(&options.realtime);
+    realtime_setup_thread(&options.realtime, "event thread");
+    if(options.realtime.probe)
+        __CATCHER_CRITICAL(latency_probe_start(&latency_probe, &reactor), "cannot start latency probe");
+
+    __STD_CATCHER_CRITICAL(device_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "cannot create device notification event");
+    __CATCHER_CRITICAL(
+        reactor_add_fd(&reactor, device_notify_fd, EPOLLIN, device_notify_callback, NULL),
+        "cannot watch device notifications"
+    );
+
+    if(options.replay_path != NULL)
+    {
+        __CATCHER_CRITICAL(open_replay_device(), "cannot replay \"%s\"", options.replay_path);
+    }
+    else
+    {
         // Initialize libusb context
         __USB_CATCHER_CRITICAL(libusb_init(&usb_context), "cannot create libusb context");
+        __CATCHER_CRITICAL(reactor_attach_usb(&reactor, usb_context), "cannot watch libusb events");
 
         __INFO("looking for compatible devices...");
-        while(!get_should_close() && !look_for_devices(&device_name)) SLEEP_FOR_US(100);
-        if(get_should_close())
-            break;
-
-        // Let us know what you've found
-        __INFO("found supported device: %s (%04x:%04x)", device_name, descriptor.idVendor, descriptor.idProduct);
-
-        // Open device
-        __INFO("connecting to device");
-        __USB_CATCHER(
-            ret = libusb_open(device, &device_handle), 
-            "cannot open device with current handle"
-        );
-        if(ret < 0)
-        {
-            switch (ret)
-            {
-            case LIBUSB_ERROR_ACCESS:
-                __WARNING("you need to be running as root in order to use this software");
-                exit(1);
-                break;
-            
-            default:
-                continue;
-            }
-        }
-        __INFO("connected!");
-
-        __INFO("configuring device...");
-        // Claim interfaces 0 and 1 (dunno yet why the two of them but it works so...)
-        claim_interface_for_handle(device_handle, &interface_0);
-        claim_interface_for_handle(device_handle, &interface_1);
-
-        // Get string descriptor, don't know why, but digimend userspace does so...
-        __USB_CATCHER_CRITICAL(
-            libusb_get_string_descriptor(device_handle, 0xc8, 0x0409, descriptor_string, sizeof(descriptor_string)), 
-            "cannot get descriptor string"
-        );
-
-        // Create virtual pen and pad
-        if(use_wacom)
-            input_id = (struct input_id *)&wacom_id;
-        else
-            input_id = (struct input_id *)&faketabletd_id;
-        
-        pad_device = create_virtual_pad(input_id, FAKETABLETD_NAME " Pad");
-        pen_device = create_virtual_pen(input_id, FAKETABLETD_NAME " Pen");
-    
-        if(use_virtual_mouse)
-            mouse_device = create_virtual_mouse();
-        if(use_virtual_keyboard)
-            keyboard_device = create_virtual_keyboard();
-
-        // Allocate space for tranfer callback
-        transfer_buffer = calloc(HID_BUFFER_SIZE, sizeof(uint8_t));
-        __CATCHER_CRITICAL(transfer_buffer == NULL ? -1 : 0, "cannot allocate memory for transfer buffer");
-
-        device_transfer = libusb_alloc_transfer(0);
-        __CATCHER_CRITICAL(device_transfer == NULL ? -1 : 0, "cannot allocate libusb transfer");
-
-        // Register transfer callback
-        libusb_fill_interrupt_transfer(device_transfer, 
-            device_handle, HID_ENDPOINT, 
-            transfer_buffer, HID_BUFFER_SIZE,
-
-            // Do keep in mind that this function will be handled from another
-            // thread, so terminating the program using exit from 
-            // here isn't an option
-            interrupt_transfer_callback,
-            
-            NULL, 0
-        );
-        __USB_CATCHER_CRITICAL(libusb_submit_transfer(device_transfer), "cannot submit device transfer");
-        __INFO("done configuring device!");
+        start_discovery();
+    }
 
-        __INFO("ready!");
-        while(!get_should_close())
-        {
-            int ret = libusb_handle_events(usb_context);
-            if(ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
-                __USB_CATCHER_CRITICAL(ret, "usb event handling error: ");
-        }
+    while(!get_should_close())
+    {
+        open_pending_devices();
 
-        if(!get_should_reset())
+        // Without -r we leave once the last tablet goes away, the rest keep
+        // going on their own until then. Replays are over once they are done
+        if(close_finished_devices() > 0 && open_device_count() == 0 &&
+            (!get_should_reset() || options.replay_path != NULL))
             break;
+
+        __CATCHER_CRITICAL(reactor_run_once(&reactor, -1), "cannot handle events");
     }
 
     __INFO("terminating...");
+    cleannup();
+    reactor_destroy(&reactor);
     return 0;
 }
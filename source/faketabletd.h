@@ -7,8 +7,16 @@
 #include <sys/types.h>
 #include <pwd.h>
 #include <linux/hid.h>
+#include <linux/input.h>
 
 #include "ini.h"
+#include "frame.h"
+#include "filter.h"
+#include "predict.h"
+#include "pressure.h"
+
+struct hid_plan_t;
+struct mapping_t;
 
 // Fake device info
 #define FAKETABLETD_VID             0x5FE1
@@ -33,10 +41,21 @@
 #define     HID_SET_PROTOCOL_REPORT 1
 #define HID_TIMEOUT                 1000
 #define HID_BUFFER_SIZE             0x40
+#define HID_MAX_PACKET_SIZE         1024
 #define HID_ENDPOINT                0x81
 
+// Number of interrupt transfers we keep queued on HID_ENDPOINT
+#define HID_TRANSFER_COUNT          4
+#define HID_MAX_TRANSFERS           32
+
 #define DEFAULT_CURSOR_SPEED        5000
 
+// How long we block while waiting for a device to show up before checking
+// whether we were asked to close, and how often we rescan the bus when
+// neither libusb hotplug nor kernel uevents are available
+#define DEVICE_WAIT_TIMEOUT_MS      500
+#define DEVICE_POLL_INTERVAL_US     500000
+
 #ifndef FAKETABLETD_UINPUT_PATH
 #define FAKETABLETD_UINPUT_PATH     "/dev/uinput"
 #endif
@@ -66,11 +85,72 @@
 #define INI_CURSOR_SPEED            16
 #define INI_BUTTON_MAX     (INI_CURSOR_SPEED + 1)
 
+#define INI_TRANSFER_COUNT          17
+#define INI_DEVICE_THREADS          18
+#define INI_THREAD_CPUS             19
+#define INI_PIPELINE                20
+#define INI_REALTIME                21
+#define INI_REALTIME_PRIORITY       22
+#define INI_REALTIME_POLICY         23
+#define INI_REALTIME_CPUS           24
+#define INI_LATENCY_PROBE           25
+#define INI_HIDRAW                  26
+#define INI_IO_URING                27
+#define INI_SINK                    28
+#define INI_AREA_X                  29
+#define INI_AREA_Y                  30
+#define INI_AREA_WIDTH              31
+#define INI_AREA_HEIGHT             32
+#define INI_ROTATION                33
+#define INI_KEEP_ASPECT             34
+#define INI_SMOOTHING               35
+#define INI_SMOOTHING_CUTOFF        36
+#define INI_SMOOTHING_BETA          37
+#define INI_PRESSURE_BETA           38
+#define INI_PREDICTION              39
+
+// Pressure curve items go together, they're read again on SIGHUP
+#define INI_PRESSURE_GAMMA          40
+#define INI_PRESSURE_CURVE          41
+#define INI_PRESSURE_MIN            42
+#define INI_PRESSURE_MAX            43
+#define INI_PRESSURE_FIRST          INI_PRESSURE_GAMMA
+#define INI_PRESSURE_LAST           INI_PRESSURE_MAX
+
+// Largest report we keep a copy of once it leaves the transfer buffer
+#define REPORT_MAX_SIZE             64
+
+// A raw report along with the CLOCK_MONOTONIC time (in ns) it arrived at
+struct report_t
+{
+    uint64_t timestamp;
+    uint32_t size;
+    uint8_t data[REPORT_MAX_SIZE];
+};
+
+// Per device storage for the drivers, so they don't need to keep
+// anything in statics
+struct driver_state_t
+{
+    int32_t last_x;
+    int32_t last_y;
+    int32_t scroll_wheel_buffer;
+    uint16_t pad_buttons;
+
+    // Smoothing and prediction, for drivers that get a filter or a
+    // predictor
+    struct filter_state_t filter;
+    struct predict_state_t predict;
+};
+
 // Object that we pass to the drivers
 struct raw_input_data_t
 {
     const uint8_t *data;
     size_t size;
+    uint64_t timestamp;
+
+    struct driver_state_t *state;
 
     int pad_device;
     int pen_device;
@@ -78,17 +158,38 @@ struct raw_input_data_t
     int mouse_device;
     int keyboard_device;
 
-    int cursor_speed;
     bool use_virtual_cursor;
     bool use_virtual_wheel;
 
     bool config_available;
+
+    // Where the driver's frames go out through
+    struct output_t *output;
+
+    // Built from the report descriptor, for the drivers that want one
+    const struct hid_plan_t *plan;
+
+    // Where on the virtual pen each position on the tablet goes
+    const struct mapping_t *mapping;
+
+    // Pen smoothing settings, NULL if smoothing is off
+    const struct filter_t *filter;
+
+    // How far ahead to predict the pen, NULL if prediction is off
+    const struct predict_t *predict;
+
+    // What each pressure level goes out as
+    const struct pressure_t *pressure;
 };
 
 typedef int (*create_virtual_device_callback_t)(struct input_id *id, const char *name);
 typedef int (*process_raw_input_callback_t)(const struct raw_input_data_t *raw_input_data);
 
 bool validate_key_presses(const char keys[INI_STRING_SIZE]);
-int simulate_key_presses(int fd, const char keys[INI_STRING_SIZE]);
+// Queues pressing and then releasing every key in keys on frame
+int simulate_key_presses(struct frame_t *frame, int fd, const char keys[INI_STRING_SIZE]);
+
+int create_virtual_mouse();
+int create_virtual_keyboard();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "filter.h"
+#include "utilities.h"
+
+int filter_setup(struct filter_t *filter, float min_cutoff, float beta, float pressure_beta)
+{
+    if(min_cutoff < 0 || beta < 0 || pressure_beta < 0)
+    {
+        __WARNING("smoothing cutoff and betas cannot be negative");
+        return -1;
+    }
+
+    *filter = (struct filter_t){
+        .min_cutoff = (int64_t)(min_cutoff * 1000.0f + 0.5f),
+        .beta = (int64_t)(beta * 1000.0f * FILTER_ONE + 0.5f),
+        .pressure_beta = (int64_t)(pressure_beta * 1000.0f * FILTER_ONE + 0.5f),
+    };
+    return 0;
+}
@@ -0,0 +1,144 @@
+#ifndef FAKETABLETD_FILTER_H__
+#define FAKETABLETD_FILTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// One Euro filter (Casiez et al., CHI 2012). Every value goes through a low
+// pass filter whose cutoff rises with how fast the value is changing, so
+// a pen that's hovering or barely moving gets smoothed, and one that's
+// moving fast doesn't lag behind.
+//
+// Everything is fixed point. Cutoffs are in mHz, values are kept with 16
+// fractional bits and speeds are in units per second
+#define FILTER_SHIFT                16
+#define FILTER_ONE                  (1 << FILTER_SHIFT)
+
+// 2 * pi, with FILTER_SHIFT fractional bits
+#define FILTER_TWO_PI               411775
+
+// Cutoff for the speed estimate itself, as in the paper
+#define FILTER_SPEED_CUTOFF         1000
+
+// Nothing smooths faster than this
+#define FILTER_MAX_CUTOFF           1000000
+
+// Reports further apart than this start the filter over, and reports
+// without a timestamp are taken to be FILTER_DEFAULT_PERIOD apart (what
+// the HS610 sends at)
+#define FILTER_MAX_PERIOD_NS        100000000ULL
+#define FILTER_DEFAULT_PERIOD_NS    3000000ULL
+
+#define FILTER_DEFAULT_CUTOFF       1.0f
+#define FILTER_DEFAULT_BETA         0.0005f
+#define FILTER_DEFAULT_PRESSURE_BETA 0.002f
+
+// Settings, worked out once from the config file. beta is in mHz per unit
+// per second, with FILTER_SHIFT fractional bits
+struct filter_t
+{
+    int64_t min_cutoff;
+    int64_t beta;
+    int64_t pressure_beta;
+};
+
+struct filter_axis_t
+{
+    int64_t value;
+    int64_t speed;
+};
+
+// Per device, kept along with the rest of the driver's state
+struct filter_state_t
+{
+    bool primed;
+    uint64_t timestamp;
+
+    // Reports tend to come at the same rate, so whatever only depends on
+    // the time between them is kept around until it changes
+    int64_t period_us;
+    int64_t rate;
+    int64_t speed_alpha;
+
+    struct filter_axis_t x;
+    struct filter_axis_t y;
+    struct filter_axis_t pressure;
+};
+
+// min_cutoff in Hz, betas in Hz per unit per second (unit being whatever
+// the pen reports in). Returns -1 if any of them is negative
+int filter_setup(struct filter_t *filter, float min_cutoff, float beta, float pressure_beta);
+
+// How much of the new value makes it through, for a cutoff (mHz) and the
+// time since the last report (us): 1 / (1 + 1 / (2 * pi * cutoff * dt))
+static inline int64_t filter_alpha(int64_t cutoff, int64_t period_us)
+{
+    int64_t a = FILTER_TWO_PI * cutoff * period_us / 1000000000LL;
+    return (a << FILTER_SHIFT) / (a + FILTER_ONE);
+}
+
+static inline int32_t filter_axis(struct filter_axis_t *axis, int32_t raw, int64_t min_cutoff, int64_t beta,
+    int64_t rate, int64_t speed_alpha, int64_t period_us)
+{
+    int64_t speed = (raw - (axis->value >> FILTER_SHIFT)) * rate, cutoff = 0;
+
+    axis->speed += (speed_alpha * (speed - axis->speed)) >> FILTER_SHIFT;
+    cutoff = min_cutoff + ((beta * (axis->speed < 0 ? -axis->speed : axis->speed)) >> FILTER_SHIFT);
+    if(cutoff > FILTER_MAX_CUTOFF)
+        cutoff = FILTER_MAX_CUTOFF;
+
+    axis->value += (filter_alpha(cutoff, period_us) * (((int64_t)raw << FILTER_SHIFT) - axis->value)) >> FILTER_SHIFT;
+    return (int32_t)((axis->value + FILTER_ONE / 2) >> FILTER_SHIFT);
+}
+
+static inline void filter_reset(struct filter_state_t *state)
+{
+    state->primed = false;
+}
+
+// Smooths a pen sample in place. The first sample after a reset (or a long
+// enough pause) goes through untouched, and so do touching down and
+// lifting the pen
+static inline void filter_apply(const struct filter_t *filter, struct filter_state_t *state, uint64_t timestamp,
+    int32_t *x, int32_t *y, int32_t *pressure)
+{
+    uint64_t period = timestamp - state->timestamp;
+    int64_t period_us = 0;
+
+    if(timestamp == 0 || timestamp <= state->timestamp)
+        period = FILTER_DEFAULT_PERIOD_NS;
+
+    if(!state->primed || period > FILTER_MAX_PERIOD_NS)
+    {
+        *state = (struct filter_state_t){
+            .primed = true,
+            .x = { .value = (int64_t)*x << FILTER_SHIFT },
+            .y = { .value = (int64_t)*y << FILTER_SHIFT },
+            .pressure = { .value = (int64_t)*pressure << FILTER_SHIFT },
+        };
+        state->timestamp = timestamp;
+        return;
+    }
+    state->timestamp = timestamp;
+
+    period_us = period / 1000 > 0 ? period / 1000 : 1;
+    if(period_us != state->period_us)
+    {
+        state->period_us = period_us;
+        state->rate = 1000000 / period_us;
+        state->speed_alpha = filter_alpha(FILTER_SPEED_CUTOFF, period_us);
+    }
+
+    *x = filter_axis(&state->x, *x, filter->min_cutoff, filter->beta, state->rate, state->speed_alpha, period_us);
+    *y = filter_axis(&state->y, *y, filter->min_cutoff, filter->beta, state->rate, state->speed_alpha, period_us);
+
+    // Pressure starts over every time the pen touches down
+    if(*pressure == 0)
+        state->pressure = (struct filter_axis_t){};
+    else if(state->pressure.value == 0)
+        state->pressure.value = (int64_t)*pressure << FILTER_SHIFT;
+    else
+        *pressure = filter_axis(&state->pressure, *pressure, filter->min_cutoff, filter->pressure_beta, state->rate, state->speed_alpha, period_us);
+}
+
+#endif
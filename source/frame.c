@@ -0,0 +1,83 @@
+#include <unistd.h>
+
+#include "frame.h"
+#include "output.h"
+#include "utilities.h"
+
+int frame_write_events(int fd, const struct input_event *events, size_t count)
+{
+    ssize_t ret = 0;
+    size_t written = 0, size = count * sizeof(struct input_event);
+    const uint8_t *buffer = (const uint8_t *)events;
+
+    // uinput takes any number of whole events per write and only stops
+    // short if one of them fails, so keep going from wherever it stopped
+    while(written < size)
+    {
+        ret = write(fd, buffer + written, size - written);
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret <= 0)
+        {
+            __WARNING("cannot send event data: %s", ret < 0 ? strerror(errno) : "short write");
+            return -1;
+        }
+        written += ret;
+    }
+
+    return 0;
+}
+
+struct frame_shadow_t *frame_find_shadow(struct frame_t *frame, int fd)
+{
+    return frame->output != NULL ? output_find_shadow(frame->output, fd) : NULL;
+}
+
+int frame_flush_device(struct frame_t *frame, struct frame_device_t *device)
+{
+    int ret = 0;
+
+    if(frame->output != NULL)
+        ret = output_write(frame->output, device->fd, device->events, device->count);
+    else
+        ret = frame_write_events(device->fd, device->events, device->count);
+
+    device->count = device->packet_start = 0;
+    return ret;
+}
+
+int frame_commit(struct frame_t *frame)
+{
+    int ret = 0;
+    bool written = false;
+    struct frame_device_t *device = NULL;
+
+    if(frame->output != NULL)
+        frame->output->decoded_at = get_time_ns();
+
+    for(size_t i = 0; i < frame->device_count; i++)
+    {
+        device = &frame->devices[i];
+
+        // Same as on SYN_REPORT, for anything left after the last one
+        if(device->shadow != NULL && !device->packet_changed)
+            device->count = device->packet_start;
+
+        if(device->count == 0)
+            continue;
+
+        written = true;
+        if(frame_flush_device(frame, device) < 0)
+            ret = -1;
+    }
+
+    if(frame->output != NULL && written)
+    {
+        if(output_submit(frame->output) < 0)
+            ret = -1;
+        frame->output->emitted_at = get_time_ns();
+    }
+
+    frame->device_count = 0;
+    return ret;
+}
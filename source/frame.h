@@ -0,0 +1,173 @@
+#ifndef FAKETABLETD_FRAME_H__
+#define FAKETABLETD_FRAME_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <linux/input.h>
+
+// A single report rarely touches more than the pen (or mouse), pad and
+// keyboard, and the biggest one (the pad frame) is 18 events long
+#define FRAME_MAX_DEVICES           4
+#define FRAME_MAX_EVENTS            64
+
+struct output_t;
+
+// What a virtual device last got from us. Just like the input core, it
+// starts out with every key released and every axis at 0
+// keys_lost is set whenever key events recorded here never made it to the
+// device after all, and left for whoever cares to clear
+struct frame_shadow_t
+{
+    int fd;
+    bool keys_lost;
+    uint64_t keys[(KEY_CNT + 63) / 64];
+    int32_t abs[ABS_CNT];
+};
+
+struct frame_device_t
+{
+    int fd;
+    size_t count;
+
+    // Events that wouldn't change anything are dropped against shadow (if
+    // there's one). packet_start is where the current packet (everything
+    // since the last SYN_REPORT) begins, and packet_changed is set once it
+    // holds anything other than EV_MSC
+    struct frame_shadow_t *shadow;
+    size_t packet_start;
+    bool packet_changed;
+
+    struct input_event events[FRAME_MAX_EVENTS];
+};
+
+// Every event produced while handling a report, grouped by the virtual
+// device it goes to. Lives on the stack of whoever is translating, and
+// goes out with a single write per device on frame_commit, either through
+// output or straight to the device if there's none
+struct frame_t
+{
+    struct output_t *output;
+    size_t device_count;
+    struct frame_device_t devices[FRAME_MAX_DEVICES];
+};
+
+static inline void frame_begin(struct frame_t *frame, struct output_t *output)
+{
+    frame->output = output;
+    frame->device_count = 0;
+}
+
+// Shadow state kept by output for fd, if any
+struct frame_shadow_t *frame_find_shadow(struct frame_t *frame, int fd);
+
+// Records the event on shadow. Returns false if the device already is in
+// the state the event would leave it in
+static inline bool frame_shadow_update(struct frame_shadow_t *shadow, uint16_t type, uint16_t code, int32_t value)
+{
+    uint64_t bit = 0;
+
+    switch (type)
+    {
+    case EV_KEY:
+        // Autorepeat always goes through
+        if(code >= KEY_CNT || value > 1)
+            return true;
+
+        bit = 1ULL << (code % 64);
+        if(((shadow->keys[code / 64] & bit) != 0) == (value != 0))
+            return false;
+        shadow->keys[code / 64] ^= bit;
+        return true;
+
+    case EV_ABS:
+        if(code >= ABS_CNT)
+            return true;
+
+        if(shadow->abs[code] == value)
+            return false;
+        shadow->abs[code] = value;
+        return true;
+
+    // Relative motion by 0 is no motion at all
+    case EV_REL:
+        return value != 0;
+
+    default:
+        return true;
+    }
+}
+
+// Writes count events to fd right away
+int frame_write_events(int fd, const struct input_event *events, size_t count);
+
+// Flushes whatever is queued for a single device. Only needed by
+// frame_append when a device runs out of room
+int frame_flush_device(struct frame_t *frame, struct frame_device_t *device);
+
+// Queues an event for fd. Returns -1 if it cannot be queued (too many
+// devices in the frame, or an early flush failed)
+static inline int frame_append(struct frame_t *frame, int fd, uint16_t type, uint16_t code, int32_t value)
+{
+    struct frame_device_t *device = NULL;
+
+    for(size_t i = 0; i < frame->device_count && device == NULL; i++)
+        if(frame->devices[i].fd == fd)
+            device = &frame->devices[i];
+
+    if(device == NULL)
+    {
+        if(frame->device_count >= FRAME_MAX_DEVICES)
+            return -1;
+        device = &frame->devices[frame->device_count++];
+        device->fd = fd;
+        device->count = 0;
+        device->shadow = frame_find_shadow(frame, fd);
+        device->packet_start = 0;
+        device->packet_changed = false;
+    }
+
+    if(device->shadow != NULL)
+    {
+        if(!frame_shadow_update(device->shadow, type, code, value))
+            return 0;
+
+        // A packet with nothing but a serial number or the like in it
+        // tells the other end nothing new, so it goes away along with its
+        // SYN_REPORT
+        if(type == EV_SYN && code == SYN_REPORT && !device->packet_changed)
+        {
+            device->count = device->packet_start;
+            return 0;
+        }
+    }
+
+    if(device->count >= FRAME_MAX_EVENTS && frame_flush_device(frame, device) < 0)
+        return -1;
+
+    // uinput stamps the events itself, so time stays zeroed
+    device->events[device->count++] = (struct input_event){
+        .type = type,
+        .code = code,
+        .value = value
+    };
+
+    if(type == EV_SYN && code == SYN_REPORT)
+    {
+        device->packet_start = device->count;
+        device->packet_changed = false;
+    }
+    else if(type != EV_MSC)
+        device->packet_changed = true;
+
+    return 0;
+}
+
+// Writes out every device's events, one write per device in the order they
+// first showed up in the frame (all pushed to the kernel at once through
+// output). Devices left with nothing new aren't written to at all. Returns
+// -1 if any of the writes failed, which with output only happens on
+// io_uring, plain writes wait or get dropped there instead
+int frame_commit(struct frame_t *frame);
+
+#endif
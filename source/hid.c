@@ -0,0 +1,504 @@
+#include <string.h>
+#include <linux/input.h>
+
+#include "hid.h"
+#include "sink.h"
+#include "utilities.h"
+
+#include "drivers/generic/generic.h"
+
+// Item types and tags, from the HID 1.11 spec (section 6.2.2)
+#define ITEM_TYPE_MAIN              0
+#define ITEM_TYPE_GLOBAL            1
+#define ITEM_TYPE_LOCAL             2
+#define ITEM_LONG                   0xfe
+
+#define MAIN_INPUT                  0x8
+#define MAIN_OUTPUT                 0x9
+#define MAIN_FEATURE                0xb
+#define MAIN_COLLECTION             0xa
+#define MAIN_END_COLLECTION         0xc
+
+#define GLOBAL_USAGE_PAGE           0x0
+#define GLOBAL_LOGICAL_MINIMUM      0x1
+#define GLOBAL_LOGICAL_MAXIMUM      0x2
+#define GLOBAL_REPORT_SIZE          0x7
+#define GLOBAL_REPORT_ID            0x8
+#define GLOBAL_REPORT_COUNT         0x9
+#define GLOBAL_PUSH                 0xa
+#define GLOBAL_POP                  0xb
+
+#define LOCAL_USAGE                 0x0
+#define LOCAL_USAGE_MINIMUM         0x1
+#define LOCAL_USAGE_MAXIMUM         0x2
+
+#define INPUT_CONSTANT              0x01
+#define INPUT_VARIABLE              0x02
+#define INPUT_RELATIVE              0x04
+
+// Usages we care about, page in the upper half
+#define USAGE(_page, _id)           ((uint32_t)(_page) << 16 | (uint32_t)(_id))
+#define USAGE_PAGE(_usage)          ((_usage) >> 16)
+
+#define PAGE_GENERIC_DESKTOP        0x01
+#define PAGE_BUTTON                 0x09
+#define PAGE_DIGITIZER              0x0d
+#define PAGE_VENDOR                 0xff00
+
+#define GD_POINTER                  USAGE(PAGE_GENERIC_DESKTOP, 0x01)
+#define GD_MOUSE                    USAGE(PAGE_GENERIC_DESKTOP, 0x02)
+#define GD_KEYPAD                   USAGE(PAGE_GENERIC_DESKTOP, 0x07)
+#define GD_X                        USAGE(PAGE_GENERIC_DESKTOP, 0x30)
+#define GD_Y                        USAGE(PAGE_GENERIC_DESKTOP, 0x31)
+#define GD_DIAL                     USAGE(PAGE_GENERIC_DESKTOP, 0x37)
+#define GD_WHEEL                    USAGE(PAGE_GENERIC_DESKTOP, 0x38)
+
+#define DIG_DIGITIZER               USAGE(PAGE_DIGITIZER, 0x01)
+#define DIG_PEN                     USAGE(PAGE_DIGITIZER, 0x02)
+#define DIG_STYLUS                  USAGE(PAGE_DIGITIZER, 0x20)
+#define DIG_TIP_PRESSURE            USAGE(PAGE_DIGITIZER, 0x30)
+#define DIG_IN_RANGE                USAGE(PAGE_DIGITIZER, 0x32)
+#define DIG_TABLET_FUNCTION_KEYS    USAGE(PAGE_DIGITIZER, 0x39)
+#define DIG_INVERT                  USAGE(PAGE_DIGITIZER, 0x3c)
+#define DIG_X_TILT                  USAGE(PAGE_DIGITIZER, 0x3d)
+#define DIG_Y_TILT                  USAGE(PAGE_DIGITIZER, 0x3e)
+#define DIG_TIP_SWITCH              USAGE(PAGE_DIGITIZER, 0x42)
+#define DIG_BARREL_SWITCH           USAGE(PAGE_DIGITIZER, 0x44)
+#define DIG_SECONDARY_BARREL_SWITCH USAGE(PAGE_DIGITIZER, 0x5a)
+
+#define MAX_USAGES                  32
+#define MAX_GLOBAL_DEPTH            4
+#define MAX_COLLECTION_DEPTH        16
+#define NO_DEVICE                   -1
+
+struct global_state_t
+{
+    uint16_t usage_page;
+    int32_t logical_minimum;
+    int32_t logical_maximum;
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+};
+
+struct local_state_t
+{
+    uint32_t usages[MAX_USAGES];
+    size_t usage_count;
+    uint32_t usage_minimum;
+    uint32_t usage_maximum;
+    bool has_range;
+};
+
+// Same buttons the HS610 driver hands out
+static const uint16_t pad_buttons[] =
+{
+    BTN_0, BTN_1, BTN_2, BTN_3, BTN_4, BTN_5, BTN_6, BTN_7,
+    BTN_8, BTN_9, BTN_A, BTN_B, BTN_C, BTN_X, BTN_Y, BTN_Z
+};
+
+static const uint16_t mouse_buttons[] = { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE };
+
+// Which virtual device the fields in a collection belong to
+static int classify_collection(uint32_t usage)
+{
+    switch (usage)
+    {
+    case DIG_DIGITIZER:
+    case DIG_PEN:
+    case DIG_STYLUS:
+        return SINK_DEVICE_PEN;
+    case DIG_TABLET_FUNCTION_KEYS:
+    case GD_KEYPAD:
+        return SINK_DEVICE_PAD;
+    case GD_MOUSE:
+        return SINK_DEVICE_MOUSE;
+    default:
+        return USAGE_PAGE(usage) >= PAGE_VENDOR ? SINK_DEVICE_PAD : NO_DEVICE;
+    }
+}
+
+// Event for usage on device. Returns false if it doesn't turn into one
+static bool map_usage(int device, uint32_t usage, uint8_t flags, struct hid_slot_t *slot)
+{
+    uint32_t button = USAGE_PAGE(usage) == PAGE_BUTTON ? (usage & 0xffff) - 1 : UINT32_MAX;
+
+    slot->device = device;
+    slot->button = HID_NO_BUTTON;
+
+    switch (device)
+    {
+    case SINK_DEVICE_PEN:
+        slot->type = EV_KEY;
+        switch (usage)
+        {
+        case GD_X:                          slot->type = EV_ABS; slot->code = ABS_X; break;
+        case GD_Y:                          slot->type = EV_ABS; slot->code = ABS_Y; break;
+        case DIG_TIP_PRESSURE:              slot->type = EV_ABS; slot->code = ABS_PRESSURE; break;
+        case DIG_X_TILT:                    slot->type = EV_ABS; slot->code = ABS_TILT_X; break;
+        case DIG_Y_TILT:                    slot->type = EV_ABS; slot->code = ABS_TILT_Y; break;
+        case DIG_TIP_SWITCH:                slot->code = BTN_TOUCH; break;
+        case DIG_BARREL_SWITCH:             slot->code = BTN_STYLUS; break;
+        case DIG_SECONDARY_BARREL_SWITCH:   slot->code = BTN_STYLUS2; break;
+        case DIG_IN_RANGE:                  slot->code = BTN_TOOL_PEN; break;
+        case DIG_INVERT:                    slot->code = BTN_TOOL_RUBBER; break;
+        case USAGE(PAGE_BUTTON, 1):         slot->code = BTN_STYLUS; break;
+        case USAGE(PAGE_BUTTON, 2):         slot->code = BTN_STYLUS2; break;
+        default:
+            return false;
+        }
+        return true;
+
+    case SINK_DEVICE_PAD:
+        if(button < GET_LEN(pad_buttons))
+        {
+            slot->type = EV_KEY;
+            slot->code = pad_buttons[button];
+            slot->button = button;
+            return true;
+        }
+        if(usage == GD_WHEEL || usage == GD_DIAL)
+        {
+            slot->type = EV_ABS;
+            slot->code = ABS_WHEEL;
+            return true;
+        }
+        return false;
+
+    case SINK_DEVICE_MOUSE:
+        if(button < GET_LEN(mouse_buttons))
+        {
+            slot->type = EV_KEY;
+            slot->code = mouse_buttons[button];
+            return true;
+        }
+
+        // An absolute mouse is a pen as far as we are concerned, and that
+        // one comes in its own collection
+        if(!(flags & INPUT_RELATIVE))
+            return false;
+
+        slot->type = EV_REL;
+        switch (usage)
+        {
+        case GD_X:      slot->code = REL_X; break;
+        case GD_Y:      slot->code = REL_Y; break;
+        case GD_WHEEL:  slot->code = REL_WHEEL; break;
+        default:
+            return false;
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static struct hid_report_plan_t *get_report_plan(struct hid_plan_t *plan, uint8_t id)
+{
+    struct hid_report_plan_t *report = NULL;
+
+    if(plan->report_index[id] != 0)
+        return &plan->reports[plan->report_index[id] - 1];
+
+    if(plan->report_count >= HID_MAX_REPORTS)
+        return NULL;
+
+    report = &plan->reports[plan->report_count++];
+    *report = (struct hid_report_plan_t){
+        .id = id, .in_range_slot = HID_NO_SLOT, .x_slot = HID_NO_SLOT, .y_slot = HID_NO_SLOT, .pressure_slot = HID_NO_SLOT
+    };
+    plan->report_index[id] = plan->report_count;
+    return report;
+}
+
+// Adds a field to the report, merging it with any earlier one for the
+// same event
+static int add_field(struct hid_report_plan_t *report, const struct hid_slot_t *event, uint16_t offset, uint8_t size, const struct global_state_t *global)
+{
+    size_t i = 0;
+    struct hid_slot_t *slot = NULL;
+
+    if(report->field_count >= HID_MAX_FIELDS)
+        return -1;
+
+    for(i = 0; i < report->slot_count; i++)
+        if(report->slots[i].device == event->device && report->slots[i].type == event->type && report->slots[i].code == event->code)
+            break;
+
+    if(i == report->slot_count)
+    {
+        if(report->slot_count >= HID_MAX_SLOTS)
+            return -1;
+        report->slots[report->slot_count++] = *event;
+    }
+
+    // The range that counts is the one declared along with the last part
+    slot = &report->slots[i];
+    if(slot->bits + size > 32)
+        return -1;
+
+    report->fields[report->field_count++] = (struct hid_field_t){
+        .offset = offset, .size = size, .slot = i, .shift = slot->bits
+    };
+    slot->bits += size;
+    slot->minimum = global->logical_minimum;
+    slot->maximum = global->logical_maximum;
+    slot->is_signed = global->logical_minimum < 0;
+
+    if(slot->device == SINK_DEVICE_PEN && slot->code == BTN_TOOL_PEN)
+        report->in_range_slot = i;
+    if(slot->device == SINK_DEVICE_PEN && slot->type == EV_ABS && slot->code == ABS_X)
+        report->x_slot = i;
+    if(slot->device == SINK_DEVICE_PEN && slot->type == EV_ABS && slot->code == ABS_Y)
+        report->y_slot = i;
+    if(slot->device == SINK_DEVICE_PEN && slot->type == EV_ABS && slot->code == ABS_PRESSURE)
+        report->pressure_slot = i;
+    report->has_pen |= slot->device == SINK_DEVICE_PEN;
+    report->has_pad |= slot->device == SINK_DEVICE_PAD;
+    report->has_mouse |= slot->device == SINK_DEVICE_MOUSE;
+    return 0;
+}
+
+static void add_input(struct hid_plan_t *plan, int device, uint8_t flags, uint16_t *bits, const struct global_state_t *global, const struct local_state_t *local)
+{
+    uint32_t usage = 0;
+    uint16_t offset = bits[global->report_id];
+    struct hid_slot_t event;
+    struct hid_report_plan_t *report = NULL;
+
+    bits[global->report_id] += global->report_size * global->report_count;
+
+    // Padding, and arrays (keyboards mostly) aren't something we handle
+    if(device == NO_DEVICE || (flags & (INPUT_CONSTANT | INPUT_VARIABLE)) != INPUT_VARIABLE ||
+        global->report_size == 0 || global->report_size > 32)
+        return;
+
+    for(uint32_t i = 0; i < global->report_count; i++, offset += global->report_size)
+    {
+        // Usages are handed out in order, the last one repeating if there
+        // are more fields than usages
+        if(local->has_range)
+            usage = MIN(local->usage_minimum + i, local->usage_maximum);
+        else if(local->usage_count > 0)
+            usage = local->usages[MIN(i, local->usage_count - 1)];
+        else
+            return;
+
+        if(!map_usage(device, usage, flags, &event) ||
+            (report = get_report_plan(plan, global->report_id)) == NULL)
+            continue;
+
+        if(add_field(report, &event, offset, global->report_size, global) < 0)
+            __WARNING("report %u has too many fields, skipping usage %08x", global->report_id, usage);
+    }
+}
+
+// Usages without a page take the current one
+static uint32_t full_usage(uint32_t value, size_t size, const struct global_state_t *global)
+{
+    return size == 4 ? value : USAGE(global->usage_page, value);
+}
+
+int hid_compile(struct hid_plan_t *plan, const uint8_t *descriptor, size_t size, const struct hid_subreports_t *subreports)
+{
+    uint8_t prefix = 0, type = 0, tag = 0;
+    size_t position = 0, data_size = 0, global_depth = 0, collection_depth = 0;
+    uint32_t value = 0, usage = 0;
+    int32_t signed_value = 0;
+    int devices[MAX_COLLECTION_DEPTH + 1] = { NO_DEVICE };
+    uint16_t bits[256] = {0};
+    struct global_state_t global = {0}, global_stack[MAX_GLOBAL_DEPTH];
+    struct local_state_t local = {0};
+    struct hid_report_plan_t *report = NULL;
+    struct hid_slot_t *slot = NULL;
+    struct hid_field_t *field = NULL;
+
+    memset(plan, 0, sizeof(*plan));
+    if(subreports != NULL)
+        plan->subreports = *subreports;
+
+    while(position < size)
+    {
+        prefix = descriptor[position++];
+
+        if(prefix == ITEM_LONG)
+        {
+            // Nothing ever uses them, just skip over
+            if(position + 2 > size)
+                break;
+            position += 2 + descriptor[position];
+            continue;
+        }
+
+        data_size = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+        type = (prefix >> 2) & 0x03;
+        tag = prefix >> 4;
+
+        if(position + data_size > size)
+        {
+            __WARNING("report descriptor ends in the middle of an item");
+            return -1;
+        }
+
+        value = 0;
+        for(size_t i = 0; i < data_size; i++)
+            value |= (uint32_t)descriptor[position + i] << (i * 8);
+        signed_value = data_size == 0 ? 0 : (int32_t)(value << (32 - data_size * 8)) >> (32 - data_size * 8);
+        position += data_size;
+
+        switch (type)
+        {
+        case ITEM_TYPE_MAIN:
+            switch (tag)
+            {
+            case MAIN_INPUT:
+                add_input(plan, devices[collection_depth], value, bits, &global, &local);
+                break;
+            case MAIN_COLLECTION:
+                if(collection_depth >= MAX_COLLECTION_DEPTH)
+                {
+                    __WARNING("report descriptor nests collections too deep");
+                    return -1;
+                }
+
+                // Whatever we can't tell goes wherever the parent goes
+                usage = local.usage_count > 0 ? local.usages[0] : 0;
+                collection_depth++;
+                devices[collection_depth] = classify_collection(usage);
+                if(devices[collection_depth] == NO_DEVICE)
+                    devices[collection_depth] = devices[collection_depth - 1];
+                break;
+            case MAIN_END_COLLECTION:
+                if(collection_depth > 0)
+                    collection_depth--;
+                break;
+            default:
+                break;
+            }
+
+            // Main items use up the local state
+            local = (struct local_state_t){0};
+            break;
+
+        case ITEM_TYPE_GLOBAL:
+            switch (tag)
+            {
+            case GLOBAL_USAGE_PAGE:         global.usage_page = value; break;
+            case GLOBAL_LOGICAL_MINIMUM:    global.logical_minimum = signed_value; break;
+
+            // Plenty of devices write their maximum as if it were unsigned,
+            // same as the kernel we only take it as signed if the minimum is
+            case GLOBAL_LOGICAL_MAXIMUM:
+                global.logical_maximum = global.logical_minimum < 0 ? signed_value : (int32_t)value;
+                break;
+            case GLOBAL_REPORT_SIZE:        global.report_size = value; break;
+            case GLOBAL_REPORT_COUNT:       global.report_count = value; break;
+            case GLOBAL_REPORT_ID:
+                if(value == 0 || value > 0xff)
+                {
+                    __WARNING("invalid report ID %u in report descriptor", value);
+                    return -1;
+                }
+                global.report_id = value;
+                plan->uses_ids = true;
+                break;
+            case GLOBAL_PUSH:
+                if(global_depth >= MAX_GLOBAL_DEPTH)
+                    return -1;
+                global_stack[global_depth++] = global;
+                break;
+            case GLOBAL_POP:
+                if(global_depth == 0)
+                    return -1;
+                global = global_stack[--global_depth];
+                break;
+            default:
+                break;
+            }
+            break;
+
+        case ITEM_TYPE_LOCAL:
+            switch (tag)
+            {
+            case LOCAL_USAGE:
+                if(local.usage_count < MAX_USAGES)
+                    local.usages[local.usage_count++] = full_usage(value, data_size, &global);
+                break;
+            case LOCAL_USAGE_MINIMUM:
+                local.usage_minimum = full_usage(value, data_size, &global);
+                local.has_range = true;
+                break;
+            case LOCAL_USAGE_MAXIMUM:
+                local.usage_maximum = full_usage(value, data_size, &global);
+                local.has_range = true;
+                break;
+            default:
+                break;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // Now that every report is laid out, move past the IDs and see how
+    // much room each one needs
+    for(size_t i = 0; i < plan->report_count; i++)
+    {
+        report = &plan->reports[i];
+        report->size = (bits[report->id] + 7) / 8 + plan->uses_ids;
+
+        for(size_t j = 0; j < report->field_count; j++)
+        {
+            field = &report->fields[j];
+            field->offset += plan->uses_ids ? 8 : 0;
+            field->byte = field->offset >> 3;
+            field->bit = field->offset & 7;
+            field->mask = (uint32_t)((1ULL << field->size) - 1);
+            field->is_wide = field->bit + field->size <= 32 && field->byte + sizeof(uint32_t) <= report->size;
+        }
+
+        // The pen goes out in the virtual pen's own ranges
+        for(size_t j = 0; j < report->slot_count; j++)
+        {
+            slot = &report->slots[j];
+            if(slot->device != SINK_DEVICE_PEN || slot->type != EV_ABS || slot->maximum <= slot->minimum)
+                continue;
+
+            if(slot->code == ABS_X)
+                slot->scale = ((uint64_t)GENERIC_PEN_MAX_X << 16) / (uint32_t)(slot->maximum - slot->minimum);
+            else if(slot->code == ABS_Y)
+                slot->scale = ((uint64_t)GENERIC_PEN_MAX_Y << 16) / (uint32_t)(slot->maximum - slot->minimum);
+            else if(slot->code == ABS_PRESSURE)
+                slot->scale = ((uint64_t)GENERIC_PEN_MAX_PRESSURE << 16) / (uint32_t)(slot->maximum - slot->minimum);
+
+            // Already in range, nothing to do
+            if(slot->scale == 1 << 16 && slot->minimum == 0)
+                slot->scale = 0;
+        }
+    }
+
+    if(plan->report_count == 0)
+    {
+        __WARNING("nothing in the report descriptor we can use");
+        return -1;
+    }
+    return plan->report_count;
+}
+
+void hid_print_plan(const struct hid_plan_t *plan, const char *name)
+{
+    const struct hid_report_plan_t *report = NULL;
+
+    for(size_t i = 0; i < plan->report_count; i++)
+    {
+        report = &plan->reports[i];
+        __INFO(
+            "%s report %u: %zu bytes, %zu fields into %zu events for the%s%s%s", name,
+            report->id, report->size, report->field_count, report->slot_count,
+            report->has_pen ? " pen" : "", report->has_pad ? " pad" : "", report->has_mouse ? " mouse" : ""
+        );
+    }
+}
@@ -0,0 +1,187 @@
+#ifndef FAKETABLETD_HID_H__
+#define FAKETABLETD_HID_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Largest report descriptor we take, same as the kernel's HID_MAX_DESCRIPTOR_SIZE
+#define HID_DESCRIPTOR_MAX_SIZE     4096
+
+#define HID_MAX_REPORTS             8
+#define HID_MAX_FIELDS              32
+#define HID_MAX_SLOTS               32
+#define HID_MAX_SUBREPORTS          4
+
+// Slot doesn't come from a pad button
+#define HID_NO_BUTTON               0xff
+#define HID_NO_SLOT                 0xff
+
+// Some tablets (Huion's, once they are in their full resolution mode) send
+// every report under the same ID and tell them apart by a byte further in,
+// which no report descriptor can describe. Reports with ID id whose byte at
+// offset matches one of the values (after mask) are looked up as if they
+// had the paired made up ID instead
+struct hid_subreports_t
+{
+    uint8_t id;
+    uint8_t offset;
+    uint8_t mask;
+    size_t count;
+    struct
+    {
+        uint8_t value;
+        uint8_t id;
+    } map[HID_MAX_SUBREPORTS];
+};
+
+// Where to find a descriptor for a family of tablets. descriptor is used
+// instead of whatever the device reports when set
+struct hid_profile_t
+{
+    const uint8_t *descriptor;
+    size_t descriptor_size;
+    const struct hid_subreports_t *subreports;
+};
+
+// size bits at offset go into slot, shifted left by shift. A usage showing
+// up more than once in the same report gets a single slot, with each field
+// holding the bits above the previous ones. byte, bit and mask are worked
+// out from offset and size once the report is laid out, and fields with at
+// least 4 bytes of report from byte on (is_wide) are read in one go
+struct hid_field_t
+{
+    uint16_t offset;
+    uint8_t size;
+    uint8_t slot;
+    uint8_t shift;
+
+    uint16_t byte;
+    uint8_t bit;
+    bool is_wide;
+    uint32_t mask;
+};
+
+// Event a slot turns into, once all of its fields are in. device is one
+// of the SINK_DEVICE_* kinds. Values are sign extended from bits if
+// minimum is negative, and mapped from [minimum, maximum] onto [0,
+// (maximum - minimum) * scale >> 16] if scale isn't 0
+struct hid_slot_t
+{
+    uint8_t device;
+    uint8_t type;
+    uint16_t code;
+    uint8_t bits;
+    uint8_t button;
+    bool is_signed;
+    int32_t minimum;
+    int32_t maximum;
+    uint32_t scale;
+};
+
+struct hid_report_plan_t
+{
+    uint8_t id;
+
+    // Reports shorter than this (in bytes, ID included) are skipped
+    size_t size;
+
+    // Pen position isn't sent while this slot reads 0
+    uint8_t in_range_slot;
+
+    // Pen position, which goes through the area mapping as a pair
+    uint8_t x_slot, y_slot;
+
+    // Goes through the pressure curve
+    uint8_t pressure_slot;
+    bool has_pen, has_pad, has_mouse;
+
+    size_t field_count;
+    size_t slot_count;
+    struct hid_field_t fields[HID_MAX_FIELDS];
+    struct hid_slot_t slots[HID_MAX_SLOTS];
+};
+
+// What to pull out of every report we care about. Built once at connect
+// time from the report descriptor, so decoding a report is only a matter
+// of going through its fields
+struct hid_plan_t
+{
+    // Reports start with their ID, unless the descriptor never declared one
+    bool uses_ids;
+    struct hid_subreports_t subreports;
+
+    // report_index[id] is 1 + the position of its plan in reports, 0 if
+    // we don't know about it
+    uint8_t report_index[256];
+    size_t report_count;
+    struct hid_report_plan_t reports[HID_MAX_REPORTS];
+};
+
+// Parses the report descriptor and builds a plan with every field we can
+// turn into an event. subreports can be NULL. Returns the number of
+// reports in the plan, or -1 if the descriptor is broken or there's
+// nothing to use in it
+int hid_compile(struct hid_plan_t *plan, const uint8_t *descriptor, size_t size, const struct hid_subreports_t *subreports);
+
+// Plan for the given report, or NULL if we don't know how to read it
+static inline const struct hid_report_plan_t *hid_find_report(const struct hid_plan_t *plan, const uint8_t *data, size_t size)
+{
+    uint8_t id = 0, index = 0;
+    const struct hid_subreports_t *subreports = &plan->subreports;
+
+    if(plan->uses_ids)
+    {
+        if(size == 0)
+            return NULL;
+        id = data[0];
+
+        if(id == subreports->id && subreports->offset < size)
+            for(size_t i = 0; i < subreports->count; i++)
+                if((data[subreports->offset] & subreports->mask) == subreports->map[i].value)
+                {
+                    id = subreports->map[i].id;
+                    break;
+                }
+    }
+
+    index = plan->report_index[id];
+    return index == 0 || size < plan->reports[index - 1].size ? NULL : &plan->reports[index - 1];
+}
+
+// Reads the field's bits, least significant first. Reports are little
+// endian, same as everything we run on
+static inline uint32_t hid_extract(const uint8_t *data, const struct hid_field_t *field)
+{
+    uint32_t word = 0;
+    uint64_t value = 0;
+    size_t count = 0;
+
+    if(field->is_wide)
+    {
+        memcpy(&word, data + field->byte, sizeof(word));
+        return (word >> field->bit) & field->mask;
+    }
+
+    count = (field->bit + field->size + 7) >> 3;
+    for(size_t i = 0; i < count; i++)
+        value |= (uint64_t)data[field->byte + i] << (i * 8);
+    return (uint32_t)(value >> field->bit) & field->mask;
+}
+
+// What a slot's bits stand for
+static inline int32_t hid_slot_value(const struct hid_slot_t *slot, uint32_t bits)
+{
+    int32_t value = (int32_t)bits;
+
+    if(slot->is_signed && slot->bits < 32)
+        value = (int32_t)(bits << (32 - slot->bits)) >> (32 - slot->bits);
+    if(slot->scale != 0)
+        value = (int32_t)(((int64_t)(value - slot->minimum) * slot->scale) >> 16);
+    return value;
+}
+
+void hid_print_plan(const struct hid_plan_t *plan, const char *name);
+
+#endif
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <dirent.h>
+
+#include "hidraw.h"
+#include "utilities.h"
+
+// Reads a single integer attribute from a sysfs directory
+static int read_sysfs_int(const char *directory, const char *name, int base, long *value)
+{
+    FILE *file = NULL;
+    char path[PATH_MAX] = {0}, buffer[32] = {0};
+
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    if((file = fopen(path, "r")) == NULL)
+        return -1;
+
+    if(fgets(buffer, sizeof(buffer), file) == NULL)
+    {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    *value = strtol(buffer, NULL, base);
+    return 0;
+}
+
+// HID_ID looks like "HID_ID=0003:0000256C:0000006E" (bus:vendor:product)
+static int read_hid_id(const char *directory, uint16_t *vendor_id, uint16_t *product_id)
+{
+    FILE *file = NULL;
+    char path[PATH_MAX] = {0}, line[128] = {0};
+    unsigned int bus = 0, vendor = 0, product = 0;
+    int ret = -1;
+
+    snprintf(path, sizeof(path), "%s/uevent", directory);
+    if((file = fopen(path, "r")) == NULL)
+        return -1;
+
+    while(ret < 0 && fgets(line, sizeof(line), file) != NULL)
+    {
+        if(sscanf(line, "HID_ID=%x:%x:%x", &bus, &vendor, &product) != 3)
+            continue;
+
+        *vendor_id = vendor;
+        *product_id = product;
+        ret = 0;
+    }
+
+    fclose(file);
+    return ret;
+}
+
+// Cuts the last component off path. Returns a pointer to it
+static char *strip_component(char *path)
+{
+    char *slash = strrchr(path, '/');
+    if(slash == NULL)
+        return NULL;
+
+    *slash = '\0';
+    return slash + 1;
+}
+
+int hidraw_find(
+    uint16_t vendor_id, uint16_t product_id,
+    uint8_t bus_number, uint8_t device_address, int interface,
+    char *path, size_t size
+)
+{
+    int ret = -1;
+    long bus = 0, address = 0;
+    uint16_t vid = 0, pid = 0;
+    char link[PATH_MAX] = {0}, hid_path[PATH_MAX] = {0};
+    char *component = NULL;
+    DIR *directory = NULL;
+    struct dirent *entry = NULL;
+
+    if((directory = opendir(HIDRAW_SYSFS_PATH)) == NULL)
+    {
+        __WARNING("cannot open \"%s\": %s", HIDRAW_SYSFS_PATH, strerror(errno));
+        return -1;
+    }
+
+    while(ret < 0 && (entry = readdir(directory)) != NULL)
+    {
+        if(strncmp(entry->d_name, "hidraw", 6) != 0)
+            continue;
+
+        // .../usb1/1-1/1-1:1.0/0003:256C:006E.0001
+        snprintf(link, sizeof(link), "%s/%s/device", HIDRAW_SYSFS_PATH, entry->d_name);
+        if(realpath(link, hid_path) == NULL)
+            continue;
+
+        if(read_hid_id(hid_path, &vid, &pid) < 0 || vid != vendor_id || pid != product_id)
+            continue;
+
+        // Up to the interface (1-1:1.0), whose number follows the last dot
+        if(strip_component(hid_path) == NULL || (component = strrchr(hid_path, '.')) == NULL)
+            continue;
+        if(strtol(component + 1, NULL, 10) != interface)
+            continue;
+
+        // And up to the USB device itself
+        if(strip_component(hid_path) == NULL ||
+            read_sysfs_int(hid_path, "busnum", 10, &bus) < 0 ||
+            read_sysfs_int(hid_path, "devnum", 10, &address) < 0)
+            continue;
+        if(bus != bus_number || address != device_address)
+            continue;
+
+        snprintf(path, size, "/dev/%s", entry->d_name);
+        ret = 0;
+    }
+
+    closedir(directory);
+    return ret;
+}
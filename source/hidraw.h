@@ -0,0 +1,21 @@
+#ifndef FAKETABLETD_HIDRAW_H__
+#define FAKETABLETD_HIDRAW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HIDRAW_SYSFS_PATH           "/sys/class/hidraw"
+#define HIDRAW_PATH_SIZE            64
+
+// Looks for the /dev/hidrawN node the kernel created for the given interface
+// of a USB device. vendor_id and product_id come from the HID_ID sysfs
+// attribute, bus_number and device_address tell apart two tablets of the
+// same model. Returns 0 and fills path if found, -1 otherwise
+int hidraw_find(
+    uint16_t vendor_id, uint16_t product_id,
+    uint8_t bus_number, uint8_t device_address, int interface,
+    char *path, size_t size
+);
+
+#endif
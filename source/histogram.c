@@ -0,0 +1,44 @@
+#include <string.h>
+
+#include "histogram.h"
+
+void histogram_reset(struct histogram_t *histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+// Largest value that lands on index
+static uint64_t bucket_limit(size_t index)
+{
+    int shift = 0;
+
+    if(index < HISTOGRAM_SUB_COUNT)
+        return index;
+
+    shift = index / HISTOGRAM_SUB_COUNT - 1;
+    return ((uint64_t)(index % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT + 1) << shift) - 1;
+}
+
+uint64_t histogram_percentile(const struct histogram_t *histogram, double percentile)
+{
+    uint64_t target = 0, seen = 0, limit = 0;
+
+    if(histogram->count == 0)
+        return 0;
+
+    target = (uint64_t)(percentile / 100.0 * histogram->count + 0.5);
+    if(target == 0)
+        target = 1;
+
+    for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if(seen >= target)
+        {
+            limit = bucket_limit(i);
+            return limit < histogram->max ? limit : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
@@ -0,0 +1,53 @@
+#ifndef FAKETABLETD_HISTOGRAM_H__
+#define FAKETABLETD_HISTOGRAM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Log-linear buckets, HDR histogram style: every power of two is split in
+// HISTOGRAM_SUB_COUNT equal buckets, so any value lands in a bucket at most
+// 1/16th (~6%) wider than itself. Values are in ns and anything over
+// 2^HISTOGRAM_MAX_BITS (~18 minutes) ends up in the last bucket
+#define HISTOGRAM_SUB_BITS          4
+#define HISTOGRAM_SUB_COUNT         (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BITS          40
+#define HISTOGRAM_BUCKETS           ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+// Written from a single thread. Whoever prints it from another one might
+// catch it halfway through a record, which is fine for stats
+struct histogram_t
+{
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+};
+
+static inline void histogram_record(struct histogram_t *histogram, uint64_t value)
+{
+    int shift = 0;
+    size_t index = value;
+
+    // Small values get a bucket each, the rest keep their top bits
+    if(value >= HISTOGRAM_SUB_COUNT)
+    {
+        shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+        index = (size_t)(shift + 1) * HISTOGRAM_SUB_COUNT + (size_t)((value >> shift) - HISTOGRAM_SUB_COUNT);
+        if(index >= HISTOGRAM_BUCKETS)
+            index = HISTOGRAM_BUCKETS - 1;
+    }
+
+    histogram->buckets[index]++;
+    histogram->count++;
+    histogram->total += value;
+    if(value > histogram->max)
+        histogram->max = value;
+}
+
+void histogram_reset(struct histogram_t *histogram);
+
+// Highest value in the bucket holding the given percentile (0 to 100),
+// capped at the largest value recorded
+uint64_t histogram_percentile(const struct histogram_t *histogram, double percentile);
+
+#endif
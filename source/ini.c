@@ -19,7 +19,7 @@
 }
 #define APPLY_TO_STATIC_STRING(dsrc_, ssrc_)                                    \
 {                                                                               \
-    uint s_ = MIN(GET_LEN(dsrc_), strlen(ssrc_));                               \
+    uint s_ = MIN(GET_LEN(dsrc_) - 1, strlen(ssrc_));                           \
     memset(dsrc_, 0, sizeof(dsrc_));                                            \
     memcpy(dsrc_, ssrc_, s_);                                                   \
 }
@@ -116,13 +116,16 @@ int ini_clear_item(int index)
     return 0;
 }
 
-static bool parse_entry(const char *label, const char *value)
+// Entries for items outside first and last are checked, but left alone
+static bool parse_entry(const char *label, const char *value, int first, int last)
 {
     struct ini_item_t *item = NULL;
+    int index = 0;
 
     for(uint i = 0; i < GET_LEN(ini_items_); i++)
     {
         item = &ini_items_[i];
+        index = i;
         if(strcmp(label, item->label) == 0) break;
         item = NULL;
     }
@@ -132,6 +135,8 @@ static bool parse_entry(const char *label, const char *value)
         __ERROR("invalid label \"%s\"", label);
         return false;
     }
+    if(index < first || index > last)
+        return true;
     if(item->type != INI_TYPE_STRING && !string_is_number(value))
     {
         __ERROR("value \"%s\" of label \"%s\" is not a number", value, label);
@@ -145,9 +150,15 @@ static bool parse_entry(const char *label, const char *value)
         item->integer = strtol(value, NULL, 10);
         break;
     case INI_TYPE_FLOAT:
-        item->integer = strtof(value, NULL);
+        item->floating = strtof(value, NULL);
         break;
     case INI_TYPE_STRING:
+        if(strlen(value) >= sizeof(item->string))
+        {
+            __ERROR("value of label \"%s\" is longer than %zu characters", label, sizeof(item->string) - 1);
+            item->_data = NULL;
+            return false;
+        }
         APPLY_TO_STATIC_STRING(item->string, value);
         break;
     default:
@@ -159,11 +170,16 @@ static bool parse_entry(const char *label, const char *value)
 }
 
 int ini_parse_file(const char *file_path)
+{
+    return ini_reparse_items(file_path, 0, INI_BUFFER_SIZE - 1);
+}
+
+int ini_reparse_items(const char *file_path, int first, int last)
 {
     FILE *fp = NULL;
     char line[100] = {0};
-    char *label = NULL, *value = NULL;
-    int start = 0, end = 0, line_number = 0, ret = 0;
+    char *label = NULL, *value = NULL, separator = 0;
+    int start = 0, end = 0, length = 0, line_number = 0, ret = 0;
 
     if(file_path == NULL)
     {
@@ -177,25 +193,25 @@ int ini_parse_file(const char *file_path)
         return -1;
     }
 
+    // Whatever isn't in the file anymore goes back to not being there
+    for(int i = MAX(first, 0); i <= last && i < INI_BUFFER_SIZE; i++)
+        ini_items_[i]._data = NULL;
+
+    // Spaces are dropped wherever they are, so "0.25, 0.1" is "0.25,0.1".
+    // separator is whatever the component ended on
 #define FIND_COMPONENT()                                                \
-    while(start < sizeof(line))                                         \
-        if(line[start] != ' ') break;                                   \
-        else start++;                                                   \
-    end = start;                                                        \
-    do                                                                  \
+    end = length = start;                                               \
+    for(; end < sizeof(line); end++)                                    \
     {                                                                   \
-        end++;                                                          \
-        if(line[end] == ' ')                                            \
-        {                                                               \
-            line[end] = '\0';                                           \
-            continue;                                                   \
-        }                                                               \
-        if(line[end] == '\n' || line[end] == '=')                       \
+        if(line[end] == '\n' || line[end] == '=' || line[end] == '\0')  \
         {                                                               \
-            line[end] = '\0';                                           \
+            separator = line[end];                                      \
+            line[length] = '\0';                                        \
             break;                                                      \
         }                                                               \
-    } while(end < sizeof(line));                                        \
+        if(line[end] != ' ')                                            \
+            line[length++] = line[end];                                 \
+    }                                                                   \
                                                                         \
     if(end >= sizeof(line))                                             \
     {                                                                   \
@@ -204,24 +220,32 @@ int ini_parse_file(const char *file_path)
     }
     while(fgets(line, sizeof(line), fp))
     {
+        start = end = 0;
+        line_number++;
+
         // Get label
         FIND_COMPONENT();
         label = &line[start];
+
+        // Blank lines are fine, labels without a value aren't
+        if(separator != '=')
+        {
+            if(*label != '\0')
+                __WARNING("invalid entry on %s:%d", file_path, line_number);
+            continue;
+        }
         start = end +1;
 
         // Get value
         FIND_COMPONENT();
         value = &line[start];
 
-        if(!parse_entry(label, value))
+        if(!parse_entry(label, value, first, last))
         {
             ret = -1;
             break;
         }
-        start = end = 0;
         label = value = NULL;
-        
-        line_number++;
     }
 #undef FIND_COMPONENT
 
@@ -6,9 +6,12 @@
 #include <string.h>
 #include <stdbool.h>
 
-#define INI_BUFFER_SIZE 20
+#define INI_BUFFER_SIZE 44
 #define INI_STRING_SIZE 20
 
+// String values, NUL included. Room for a pressure curve's four floats
+#define INI_VALUE_SIZE  48
+
 #define INI_TYPE_INT    0
 #define INI_TYPE_FLOAT  1
 #define INI_TYPE_STRING 2
@@ -21,7 +24,7 @@ struct ini_item_t
     {
         long    integer;
         float   floating;
-        char    string[INI_STRING_SIZE];
+        char    string[INI_VALUE_SIZE];
 
         void    *_generic;
     };
@@ -43,4 +46,8 @@ bool ini_item_is_populated(int index);
 
 int ini_parse_file(const char *file_path);
 
+// Parses file_path again, but only updates items first to last (both
+// included), so the rest can still be in use while it runs
+int ini_reparse_items(const char *file_path, int first, int last);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "mapping.h"
+#include "utilities.h"
+
+// a / b, to the nearest integer
+static int64_t div_round(int64_t a, int64_t b)
+{
+    return (a < 0) == (b < 0) ? (a + b / 2) / b : (a - b / 2) / b;
+}
+
+// Sets up one output axis as out = (in - from) * max / span, where in is
+// the tablet's y if use_y is set and its x otherwise. span is negative for
+// axes that run backwards
+static void mapping_axis(int64_t *from_x, int64_t *from_y, int64_t *offset, bool use_y, int32_t from, int32_t span, int32_t max)
+{
+    int64_t scale = div_round((int64_t)max << MAPPING_SHIFT, span);
+
+    *from_x = use_y ? 0 : scale;
+    *from_y = use_y ? scale : 0;
+
+    // Half a unit, so the shift rounds rather than truncates
+    *offset = -(int64_t)from * scale + (1 << (MAPPING_SHIFT - 1));
+}
+
+bool mapping_rotation_is_valid(int rotation)
+{
+    return rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270;
+}
+
+int mapping_compute(struct mapping_t *mapping, const struct mapping_options_t *options, int32_t max_x, int32_t max_y, int cursor_speed)
+{
+    int32_t x = options->area_x, y = options->area_y, width = options->area_width, height = options->area_height, size = 0;
+    bool sideways = options->rotation == 90 || options->rotation == 270;
+
+    if(max_x <= 0 || max_y <= 0)
+    {
+        __WARNING("cannot map onto a %dx%d pen", max_x, max_y);
+        return -1;
+    }
+    if(!mapping_rotation_is_valid(options->rotation))
+    {
+        __WARNING("invalid rotation %d, it can only be 0, 90, 180 or 270", options->rotation);
+        return -1;
+    }
+
+    if(width == 0)
+        width = max_x - x;
+    if(height == 0)
+        height = max_y - y;
+    if(x < 0 || y < 0 || width <= 0 || height <= 0 || (int64_t)x + width > max_x || (int64_t)y + height > max_y)
+    {
+        __WARNING("area %dx%d at %d,%d doesn't fit on a %dx%d tablet", width, height, x, y, max_x, max_y);
+        return -1;
+    }
+
+    // Turned sideways, the area's height ends up across the pen
+    if(options->keep_aspect)
+    {
+        if(!sideways && (int64_t)width * max_y > (int64_t)height * max_x)
+        {
+            size = div_round((int64_t)height * max_x, max_y);
+            x += (width - size) / 2;
+            width = size;
+        }
+        else if(!sideways)
+        {
+            size = div_round((int64_t)width * max_y, max_x);
+            y += (height - size) / 2;
+            height = size;
+        }
+        else if((int64_t)height * max_y > (int64_t)width * max_x)
+        {
+            size = div_round((int64_t)width * max_x, max_y);
+            y += (height - size) / 2;
+            height = size;
+        }
+        else
+        {
+            size = div_round((int64_t)height * max_y, max_x);
+            x += (width - size) / 2;
+            width = size;
+        }
+    }
+
+    switch (options->rotation)
+    {
+    case 0:
+        mapping_axis(&mapping->xx, &mapping->xy, &mapping->x0, false, x, width, max_x);
+        mapping_axis(&mapping->yx, &mapping->yy, &mapping->y0, true, y, height, max_y);
+        break;
+    case 90:
+        mapping_axis(&mapping->xx, &mapping->xy, &mapping->x0, true, y + height, -height, max_x);
+        mapping_axis(&mapping->yx, &mapping->yy, &mapping->y0, false, x, width, max_y);
+        break;
+    case 180:
+        mapping_axis(&mapping->xx, &mapping->xy, &mapping->x0, false, x + width, -width, max_x);
+        mapping_axis(&mapping->yx, &mapping->yy, &mapping->y0, true, y + height, -height, max_y);
+        break;
+    case 270:
+        mapping_axis(&mapping->xx, &mapping->xy, &mapping->x0, true, y, height, max_x);
+        mapping_axis(&mapping->yx, &mapping->yy, &mapping->y0, false, x + width, -width, max_y);
+        break;
+    }
+
+    mapping->max_x = max_x;
+    mapping->max_y = max_y;
+
+    // The cursor moves cursor_speed units for the pen crossing the whole
+    // width of the virtual pen, either way
+    mapping->cursor = div_round((int64_t)cursor_speed << MAPPING_SHIFT, max_x);
+
+    if(width != max_x || height != max_y || options->rotation != 0)
+        __INFO("mapping a %dx%d area at %d,%d, rotated %d degrees", width, height, x, y, options->rotation);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef FAKETABLETD_MAPPING_H__
+#define FAKETABLETD_MAPPING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Coefficients are 16.16 fixed point
+#define MAPPING_SHIFT               16
+
+// Which part of the tablet the pen covers the whole virtual pen with, and
+// how the tablet sits on the desk
+struct mapping_options_t
+{
+    // Active area, in tablet units. A width or height of 0 takes all of it
+    int32_t area_x;
+    int32_t area_y;
+    int32_t area_width;
+    int32_t area_height;
+
+    // Degrees the tablet is turned clockwise, 0, 90, 180 or 270
+    int rotation;
+
+    // Crops the area (around its center) until it has the same aspect
+    // ratio as the virtual pen, so circles stay circles
+    bool keep_aspect;
+};
+
+// Tablet to virtual pen coordinates, as one integer affine transform:
+//
+//  x' = (xx * x + xy * y + x0) >> MAPPING_SHIFT
+//  y' = (yx * x + yy * y + y0) >> MAPPING_SHIFT
+//
+// clamped to [0, max_x] and [0, max_y]. cursor is how many mouse units each
+// unit of mapped movement is worth, with cursor_speed folded in
+struct mapping_t
+{
+    int64_t xx, xy, x0;
+    int64_t yx, yy, y0;
+    int32_t max_x;
+    int32_t max_y;
+    int64_t cursor;
+};
+
+// Works out the transform for a tablet whose virtual pen goes from 0 to
+// max_x and max_y, which is also the range the tablet itself reports in.
+// Returns -1 if the area doesn't fit on it or the rotation makes no sense
+int mapping_compute(struct mapping_t *mapping, const struct mapping_options_t *options, int32_t max_x, int32_t max_y, int cursor_speed);
+
+// Only checks the rotation, the area depends on the tablet
+bool mapping_rotation_is_valid(int rotation);
+
+static inline int32_t mapping_clamp(int64_t value, int32_t max)
+{
+    return value < 0 ? 0 : value > max ? max : (int32_t)value;
+}
+
+static inline void mapping_apply(const struct mapping_t *mapping, int32_t *x, int32_t *y)
+{
+    int64_t in_x = *x, in_y = *y;
+
+    *x = mapping_clamp((mapping->xx * in_x + mapping->xy * in_y + mapping->x0) >> MAPPING_SHIFT, mapping->max_x);
+    *y = mapping_clamp((mapping->yx * in_x + mapping->yy * in_y + mapping->y0) >> MAPPING_SHIFT, mapping->max_y);
+}
+
+// Mouse movement for a change in mapped position. Rounds towards 0, the
+// way the cursor always has
+static inline int32_t mapping_cursor(const struct mapping_t *mapping, int32_t delta)
+{
+    return (int32_t)(delta * mapping->cursor / (1 << MAPPING_SHIFT));
+}
+
+#endif
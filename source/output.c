@@ -0,0 +1,717 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "output.h"
+#include "utilities.h"
+
+// No liburing around, so we talk to the kernel ourselves
+static inline int io_uring_setup(uint32_t entries, struct io_uring_params *params)
+{ return (int)syscall(__NR_io_uring_setup, entries, params); }
+static inline int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{ return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0); }
+static inline int io_uring_register(int fd, uint32_t opcode, const void *arg, uint32_t count)
+{ return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count); }
+
+#define RING_OFFSET(_ring, _offset)     ((uint32_t *)((uint8_t *)(_ring) + (_offset)))
+
+// What a shadow holds for an axis after events that never made it out. No
+// event has it, so whatever comes next for that axis goes out
+#define SHADOW_UNKNOWN                  INT32_MIN
+
+void output_init(struct output_t *output)
+{
+    output->sink = NULL;
+    output->sink_state = NULL;
+    output->use_io_uring = false;
+    output->ring_fd = -1;
+    output->sq_ring = output->cq_ring = MAP_FAILED;
+    output->sqes = MAP_FAILED;
+    output->file_count = 0;
+    output->queued = output->in_flight = 0;
+    output->busy_files = 0;
+
+    output->free_count = OUTPUT_QUEUE_DEPTH;
+    for(size_t i = 0; i < OUTPUT_QUEUE_DEPTH; i++)
+        output->free_slots[i] = OUTPUT_QUEUE_DEPTH - 1 - i;
+
+    output->pending_count = 0;
+    output->pending_files = 0;
+    for(size_t i = 0; i < OUTPUT_PENDING_DEPTH; i++)
+        output->pending_free[i] = i;
+
+    output->writes = output->errors = output->completions = 0;
+    output->latency_total = output->latency_max = 0;
+    output->depth_total = output->depth_max = 0;
+    output->deferred = output->pending_max = 0;
+    for(size_t i = 0; i < OUTPUT_PRIORITY_COUNT; i++)
+        output->dropped[i] = 0;
+}
+
+// Whether the kernel knows IORING_OP_WRITE, which only came in 5.6. Older
+// ones take the ring just fine and then fail every write with EINVAL.
+// Probing came in at the same time, so not having it means no
+static bool probe_write(int ring_fd)
+{
+    struct io_uring_probe *probe = NULL;
+    bool supported = false;
+
+    if((probe = calloc(1, sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op))) == NULL)
+        return false;
+
+    if(io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0)
+        supported = IORING_OP_WRITE < probe->ops_len && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+
+    free(probe);
+    return supported;
+}
+
+static int setup_ring(struct output_t *output)
+{
+    struct io_uring_params params = (struct io_uring_params){};
+
+    if((output->ring_fd = io_uring_setup(OUTPUT_QUEUE_DEPTH, &params)) < 0)
+    {
+        __WARNING("cannot create io_uring instance: %s", strerror(errno));
+        return -1;
+    }
+    if(!probe_write(output->ring_fd))
+    {
+        __WARNING("io_uring on this kernel cannot write to files");
+        return -1;
+    }
+    output->sq_entries = params.sq_entries;
+
+    output->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    output->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        output->sq_ring_size = output->cq_ring_size = MAX(output->sq_ring_size, output->cq_ring_size);
+
+    output->sq_ring = mmap(
+        NULL, output->sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, output->ring_fd, IORING_OFF_SQ_RING
+    );
+    if(output->sq_ring == MAP_FAILED)
+    {
+        __WARNING("cannot map io_uring submission ring: %s", strerror(errno));
+        return -1;
+    }
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        output->cq_ring = output->sq_ring;
+    else if((output->cq_ring = mmap(
+        NULL, output->cq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, output->ring_fd, IORING_OFF_CQ_RING
+    )) == MAP_FAILED)
+    {
+        __WARNING("cannot map io_uring completion ring: %s", strerror(errno));
+        return -1;
+    }
+
+    output->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    output->sqes = mmap(
+        NULL, output->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, output->ring_fd, IORING_OFF_SQES
+    );
+    if(output->sqes == MAP_FAILED)
+    {
+        __WARNING("cannot map io_uring submission entries: %s", strerror(errno));
+        return -1;
+    }
+
+    output->sq_head = RING_OFFSET(output->sq_ring, params.sq_off.head);
+    output->sq_tail = RING_OFFSET(output->sq_ring, params.sq_off.tail);
+    output->sq_mask = RING_OFFSET(output->sq_ring, params.sq_off.ring_mask);
+    output->sq_array = RING_OFFSET(output->sq_ring, params.sq_off.array);
+    output->cq_head = RING_OFFSET(output->cq_ring, params.cq_off.head);
+    output->cq_tail = RING_OFFSET(output->cq_ring, params.cq_off.tail);
+    output->cq_mask = RING_OFFSET(output->cq_ring, params.cq_off.ring_mask);
+    output->cqes = (struct io_uring_cqe *)((uint8_t *)output->cq_ring + params.cq_off.cqes);
+
+    // Registering the fds up front saves the kernel from looking them up
+    // (and taking a reference) on every single write
+    if(output->file_count > 0 && io_uring_register(
+        output->ring_fd, IORING_REGISTER_FILES, output->files, output->file_count
+    ) < 0)
+    {
+        __WARNING("cannot register virtual devices with io_uring: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static void close_ring(struct output_t *output)
+{
+    if(output->sqes != MAP_FAILED)
+        munmap(output->sqes, output->sqes_size);
+    if(output->cq_ring != MAP_FAILED && output->cq_ring != output->sq_ring)
+        munmap(output->cq_ring, output->cq_ring_size);
+    if(output->sq_ring != MAP_FAILED)
+        munmap(output->sq_ring, output->sq_ring_size);
+    if(output->ring_fd >= 0)
+        close(output->ring_fd);
+
+    output->sq_ring = output->cq_ring = MAP_FAILED;
+    output->sqes = MAP_FAILED;
+    output->ring_fd = -1;
+    output->use_io_uring = false;
+    output->queued = output->in_flight = 0;
+    output->busy_files = 0;
+}
+
+void output_setup(struct output_t *output, const struct sink_t *sink, struct sink_state_t *sink_state, bool use_io_uring, const int *fds, size_t count)
+{
+    output->sink = sink;
+    output->sink_state = sink_state;
+
+    output->file_count = 0;
+    for(size_t i = 0; i < count && output->file_count < OUTPUT_MAX_FILES; i++)
+    {
+        if(fds[i] < 0)
+            continue;
+
+        output->files[output->file_count] = fds[i];
+        output->shadows[output->file_count] = (struct frame_shadow_t){ .fd = fds[i] };
+        output->file_count++;
+    }
+
+    if(!use_io_uring)
+        return;
+
+    if(sink != NULL && sink->write != NULL)
+    {
+        __WARNING("the %s sink doesn't write to file descriptors, not using io_uring", sink->name);
+        return;
+    }
+
+    if(setup_ring(output) < 0)
+    {
+        __WARNING("falling back to plain writes");
+        close_ring(output);
+        return;
+    }
+
+    output->use_io_uring = true;
+}
+
+struct frame_shadow_t *output_find_shadow(struct output_t *output, int fd)
+{
+    for(size_t i = 0; i < output->file_count; i++)
+        if(output->files[i] == fd)
+            return &output->shadows[i];
+    return NULL;
+}
+
+static void write_failed(struct output_t *output, int error)
+{
+    // Only the first one, uinput going away tends to fail everything
+    if(output->errors++ == 0)
+        __WARNING("cannot send event data: %s", strerror(error));
+}
+
+static void forget_events(struct frame_shadow_t *shadow, const struct input_event *events, size_t count);
+static void hold_events(struct output_t *output, size_t file, const struct input_event *events, size_t count);
+
+static void complete_slot(struct output_t *output, const struct io_uring_cqe *cqe, uint64_t now)
+{
+    uint32_t index = (uint32_t)cqe->user_data;
+    struct output_slot_t *slot = &output->slots[index];
+    uint64_t latency = now - slot->submitted;
+    size_t written = cqe->res > 0 ? cqe->res / sizeof(struct input_event) : 0;
+
+    output->busy_files &= ~(1u << slot->file);
+
+    // The virtual devices are non-blocking, so io_uring hands a busy one's
+    // EAGAIN (or a short write) back to us instead of waiting. What's left
+    // waits in the queue, same as with plain writes. Nothing newer for the
+    // device went out meanwhile, those were held back behind this one
+    if(cqe->res == -EAGAIN || (cqe->res > 0 && written < slot->count))
+        hold_events(output, slot->file, slot->events + written, slot->count - written);
+    else if(cqe->res <= 0)
+    {
+        write_failed(output, cqe->res < 0 ? -cqe->res : EIO);
+        forget_events(&output->shadows[slot->file], slot->events, slot->count);
+    }
+
+    output->completions++;
+    output->latency_total += latency;
+    if(latency > output->latency_max)
+        output->latency_max = latency;
+
+    output->free_slots[output->free_count++] = index;
+    output->in_flight--;
+}
+
+void output_reap(struct output_t *output)
+{
+    uint32_t head = 0, tail = 0;
+    uint64_t now = 0;
+
+    if(!output->use_io_uring || output->in_flight == 0)
+        return;
+
+    head = *output->cq_head;
+    tail = __atomic_load_n(output->cq_tail, __ATOMIC_ACQUIRE);
+    if(head == tail)
+        return;
+
+    now = get_time_ns();
+    for(; head != tail; head++)
+        complete_slot(output, &output->cqes[head & *output->cq_mask], now);
+
+    __atomic_store_n(output->cq_head, head, __ATOMIC_RELEASE);
+}
+
+int output_submit(struct output_t *output)
+{
+    int ret = 0;
+
+    while(output->use_io_uring && output->queued > 0)
+    {
+        ret = io_uring_enter(output->ring_fd, output->queued, 0, 0);
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret < 0)
+        {
+            __WARNING("cannot submit event data: %s", strerror(errno));
+            return -1;
+        }
+        output->queued -= ret;
+    }
+
+    // uinput never blocks, so most writes are already done by the time
+    // io_uring_enter returns, and whatever waited on them can go too
+    output_reap(output);
+    if(output->pending_files & ~output->busy_files)
+        output_flush(output);
+    return 0;
+}
+
+// Blocks until at least one write completes, if any is on its way
+static int wait_for_completion(struct output_t *output)
+{
+    int ret = 0;
+
+    if(output_submit(output) < 0)
+        return -1;
+    if(output->in_flight == 0)
+        return 0;
+
+    while((ret = io_uring_enter(output->ring_fd, 0, 1, IORING_ENTER_GETEVENTS)) < 0 && errno == EINTR);
+    if(ret < 0)
+    {
+        __WARNING("cannot wait for event data: %s", strerror(errno));
+        return -1;
+    }
+
+    output_reap(output);
+    return 0;
+}
+
+// Writes as many of events as fd takes right now. Returns how many went
+// out, or -1 if fd won't take them at all
+static ssize_t write_some(int fd, const struct input_event *events, size_t count)
+{
+    ssize_t ret = 0;
+    size_t written = 0, size = count * sizeof(struct input_event);
+
+    // uinput takes any number of whole events per write and only stops
+    // short if one of them fails, so keep going from wherever it stopped
+    while(written < size)
+    {
+        ret = write(fd, (const uint8_t *)events + written, size - written);
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if(ret == 0)
+            errno = EIO;
+        if(ret <= 0)
+            return -1;
+        written += ret;
+    }
+
+    return written / sizeof(struct input_event);
+}
+
+static inline bool shadow_key(const struct frame_shadow_t *shadow, uint16_t code)
+{
+    return (shadow->keys[code / 64] >> (code % 64)) & 1;
+}
+
+// The shadow already holds whatever the frame leaves the device in, so
+// it knows whether the pen (or mouse button) is down
+static int frame_priority(const struct frame_shadow_t *shadow, const struct input_event *events, size_t count)
+{
+    int priority = OUTPUT_PRIORITY_HOVER;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(events[i].type == EV_KEY)
+            return OUTPUT_PRIORITY_STATE;
+        if(events[i].type == EV_REL)
+            priority = OUTPUT_PRIORITY_CONTACT;
+    }
+
+    if(shadow_key(shadow, BTN_TOUCH) || shadow_key(shadow, BTN_LEFT))
+        priority = OUTPUT_PRIORITY_CONTACT;
+    return priority;
+}
+
+// The device never got these, so its shadow shouldn't say it did. Keys go
+// back to what they were before, and keys_lost tells drivers that only send
+// keys that changed to look at the shadow again
+static void forget_events(struct frame_shadow_t *shadow, const struct input_event *events, size_t count)
+{
+    const struct input_event *event = NULL;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        event = &events[i];
+        if(event->type == EV_ABS && event->code < ABS_CNT)
+            shadow->abs[event->code] = SHADOW_UNKNOWN;
+        else if(event->type == EV_KEY && event->code < KEY_CNT && event->value <= 1 && shadow_key(shadow, event->code) == (event->value != 0))
+        {
+            shadow->keys[event->code / 64] ^= 1ULL << (event->code % 64);
+            shadow->keys_lost = true;
+        }
+    }
+}
+
+static void update_pending_files(struct output_t *output)
+{
+    output->pending_files = 0;
+    for(size_t i = 0; i < output->pending_count; i++)
+        output->pending_files |= 1u << output->pending[output->pending_order[i]].file;
+}
+
+static void remove_pending(struct output_t *output, size_t position)
+{
+    output->pending_free[OUTPUT_PENDING_DEPTH - output->pending_count] = output->pending_order[position];
+    memmove(
+        &output->pending_order[position], &output->pending_order[position + 1],
+        (output->pending_count - position - 1) * sizeof(size_t)
+    );
+    output->pending_count--;
+}
+
+// Takes the frame at position out of the queue, without sending what's
+// left of it. If part of it already went out, the device gets a
+// SYN_REPORT so it isn't left halfway through a packet
+static void discard_pending(struct output_t *output, size_t position)
+{
+    struct output_pending_t *pending = &output->pending[output->pending_order[position]];
+    const struct input_event syn = (struct input_event){ .type = EV_SYN, .code = SYN_REPORT };
+
+    forget_events(&output->shadows[pending->file], pending->events + pending->offset, pending->count - pending->offset);
+    if(pending->offset > 0)
+        write_some(output->files[pending->file], &syn, 1);
+    remove_pending(output, position);
+}
+
+// Where the frame to make room for one worth priority is, or -1 if none of
+// them can go. Key changes never do, since drivers only send those once,
+// and neither do frames that are already partly out
+static ssize_t find_victim(const struct output_t *output, int priority)
+{
+    ssize_t victim = -1;
+    const struct output_pending_t *pending = NULL;
+
+    for(size_t i = 0; i < output->pending_count; i++)
+    {
+        pending = &output->pending[output->pending_order[i]];
+        if(pending->priority == OUTPUT_PRIORITY_STATE || pending->priority > priority || pending->offset > 0)
+            continue;
+        if(victim < 0 || pending->priority < output->pending[output->pending_order[victim]].priority)
+            victim = i;
+    }
+
+    return victim;
+}
+
+// Tacks events onto the newest frame waiting for file, if there's one with
+// room for them. They'd go right after it anyway
+static bool merge_events(struct output_t *output, size_t file, int priority, const struct input_event *events, size_t count)
+{
+    struct output_pending_t *pending = NULL;
+
+    for(size_t i = output->pending_count; i-- > 0;)
+    {
+        pending = &output->pending[output->pending_order[i]];
+        if(pending->file != file)
+            continue;
+        if(pending->count + count > FRAME_MAX_EVENTS)
+            return false;
+
+        memcpy(&pending->events[pending->count], events, count * sizeof(struct input_event));
+        pending->count += count;
+        pending->priority = MAX(pending->priority, priority);
+        return true;
+    }
+
+    return false;
+}
+
+// Keeps events for file until it has room for them. With the queue full
+// they go along with the last frame for file if they fit, and otherwise
+// either the lowest priority frame waiting or this one goes
+static void hold_events(struct output_t *output, size_t file, const struct input_event *events, size_t count)
+{
+    int priority = frame_priority(&output->shadows[file], events, count);
+    ssize_t victim = 0;
+    size_t index = 0;
+    struct output_pending_t *pending = NULL;
+
+    if(output->pending_count == OUTPUT_PENDING_DEPTH)
+    {
+        if(merge_events(output, file, priority, events, count))
+        {
+            output->deferred++;
+            return;
+        }
+
+        // With every frame waiting being a key change, there's nothing left
+        // but to lose one. Whoever sent it finds out through the shadow
+        if((victim = find_victim(output, priority == OUTPUT_PRIORITY_STATE ? OUTPUT_PRIORITY_CONTACT : priority)) < 0)
+        {
+            forget_events(&output->shadows[file], events, count);
+            output->dropped[priority]++;
+            return;
+        }
+
+        output->dropped[output->pending[output->pending_order[victim]].priority]++;
+        discard_pending(output, victim);
+    }
+
+    index = output->pending_free[OUTPUT_PENDING_DEPTH - output->pending_count - 1];
+    output->pending_order[output->pending_count++] = index;
+
+    pending = &output->pending[index];
+    pending->file = file;
+    pending->priority = priority;
+    pending->offset = 0;
+    pending->count = count;
+    memcpy(pending->events, events, count * sizeof(struct input_event));
+
+    output->deferred++;
+    if(output->pending_count > output->pending_max)
+        output->pending_max = output->pending_count;
+    update_pending_files(output);
+}
+
+void output_flush(struct output_t *output)
+{
+    ssize_t ret = 0;
+    size_t i = 0;
+    uint32_t blocked = 0;
+    struct output_pending_t *pending = NULL;
+
+    // Devices with a write still on its way have to wait for it
+    output_reap(output);
+    blocked = output->busy_files;
+
+    while(i < output->pending_count)
+    {
+        pending = &output->pending[output->pending_order[i]];
+
+        // Frames for a device go out in order, so once one has to wait
+        // every one after it for that device does too
+        if(blocked & (1u << pending->file))
+        {
+            i++;
+            continue;
+        }
+
+        ret = write_some(output->files[pending->file], pending->events + pending->offset, pending->count - pending->offset);
+        if(ret < 0)
+        {
+            write_failed(output, errno);
+            discard_pending(output, i);
+            continue;
+        }
+
+        pending->offset += ret;
+        if(pending->offset < pending->count)
+        {
+            blocked |= 1u << pending->file;
+            i++;
+            continue;
+        }
+
+        output->writes++;
+        remove_pending(output, i);
+    }
+
+    update_pending_files(output);
+}
+
+static int write_events(struct output_t *output, int file, int fd, const struct input_event *events, size_t count)
+{
+    ssize_t ret = 0;
+    int error = 0;
+    uint64_t start = 0, latency = 0;
+
+    if(output->pending_count > 0)
+        output_flush(output);
+
+    // Whatever is still waiting for the device goes first
+    if(file >= 0 && (output->pending_files & (1u << file)))
+    {
+        hold_events(output, file, events, count);
+        return 0;
+    }
+
+    start = get_time_ns();
+    ret = write_some(fd, events, count);
+    error = errno;
+
+    latency = get_time_ns() - start;
+    output->writes++;
+    output->completions++;
+    output->latency_total += latency;
+    if(latency > output->latency_max)
+        output->latency_max = latency;
+
+    if(ret < 0)
+    {
+        write_failed(output, error);
+        if(file >= 0)
+            forget_events(&output->shadows[file], events, count);
+    }
+    else if((size_t)ret < count && file >= 0)
+        hold_events(output, file, events + ret, count - ret);
+    // Handles we don't keep a shadow for can't wait, there's nothing to
+    // tell what their events are worth
+    else if((size_t)ret < count)
+        write_failed(output, EAGAIN);
+    return 0;
+}
+
+int output_write(struct output_t *output, int fd, const struct input_event *events, size_t count)
+{
+    int file = -1;
+    uint32_t index = 0, tail = 0;
+    struct output_slot_t *slot = NULL;
+    struct io_uring_sqe *sqe = NULL;
+
+    if(output->sink != NULL && output->sink->write != NULL)
+    {
+        output->writes++;
+        return output->sink->write(output->sink_state, fd, events, count);
+    }
+
+    for(size_t i = 0; i < output->file_count && file < 0; i++)
+        if(output->files[i] == fd)
+            file = i;
+
+    if(!output->use_io_uring || file < 0)
+        return write_events(output, file, fd, events, count);
+
+    output_reap(output);
+    if(output->free_count == 0 && wait_for_completion(output) < 0)
+        return -1;
+
+    if(output->pending_count > 0)
+        output_flush(output);
+
+    // Whatever is still waiting for the device (or on its way to it) goes
+    // first
+    if((output->pending_files | output->busy_files) & (1u << file))
+    {
+        hold_events(output, file, events, count);
+        return 0;
+    }
+
+    // We never have more slots than sqes, so there's always room on the
+    // submission ring once we've got a slot
+    index = output->free_slots[--output->free_count];
+    slot = &output->slots[index];
+    slot->file = file;
+    slot->count = count;
+    memcpy(slot->events, events, count * sizeof(struct input_event));
+
+    tail = *output->sq_tail;
+    sqe = &output->sqes[tail & *output->sq_mask];
+    *sqe = (struct io_uring_sqe){
+        .opcode = IORING_OP_WRITE,
+        .flags = IOSQE_FIXED_FILE,
+        .fd = file,
+        .off = (uint64_t)-1,
+        .addr = (uint64_t)(uintptr_t)slot->events,
+        .len = count * sizeof(struct input_event),
+        .user_data = index
+    };
+    output->sq_array[tail & *output->sq_mask] = tail & *output->sq_mask;
+    __atomic_store_n(output->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    slot->submitted = get_time_ns();
+    output->queued++;
+    output->in_flight++;
+    output->busy_files |= 1u << file;
+    output->writes++;
+    output->depth_total += output->in_flight;
+    if(output->in_flight > output->depth_max)
+        output->depth_max = output->in_flight;
+
+    return 0;
+}
+
+void output_drain(struct output_t *output)
+{
+    while(output->use_io_uring && output->in_flight > 0)
+        if(wait_for_completion(output) < 0)
+            break;
+
+    // Whatever still doesn't fit after this never will
+    if(output->pending_count > 0)
+        output_flush(output);
+}
+
+void output_close(struct output_t *output)
+{
+    output_drain(output);
+    close_ring(output);
+    output->file_count = 0;
+    output->pending_count = 0;
+    output->pending_files = 0;
+    for(size_t i = 0; i < OUTPUT_PENDING_DEPTH; i++)
+        output->pending_free[i] = i;
+}
+
+void output_print_stats(const struct output_t *output, const char *name)
+{
+    if(output->completions == 0)
+        return;
+
+    if(output->deferred > 0)
+    {
+        __INFO(
+            "%s output: %llu frames deferred, %zu at most and %zu now waiting, %llu hover, %llu contact and "
+            "%llu state frames dropped", name,
+            (unsigned long long)output->deferred, output->pending_max, output->pending_count,
+            (unsigned long long)output->dropped[OUTPUT_PRIORITY_HOVER],
+            (unsigned long long)output->dropped[OUTPUT_PRIORITY_CONTACT],
+            (unsigned long long)output->dropped[OUTPUT_PRIORITY_STATE]
+        );
+    }
+
+    if(!output->use_io_uring)
+    {
+        __INFO(
+            "%s output: %llu writes, %llu errors, %.1f us average, %.1f us max per write", name,
+            (unsigned long long)output->writes, (unsigned long long)output->errors,
+            output->latency_total / (double)output->completions / 1e3, output->latency_max / 1e3
+        );
+        return;
+    }
+
+    __INFO(
+        "%s io_uring output: %llu writes, %llu errors, %.1f us average, %.1f us max to completion, "
+        "%.1f average, %u max in flight", name,
+        (unsigned long long)output->writes, (unsigned long long)output->errors,
+        output->latency_total / (double)output->completions / 1e3, output->latency_max / 1e3,
+        output->writes > 0 ? output->depth_total / (double)output->writes : 0.0, output->depth_max
+    );
+}
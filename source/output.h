@@ -0,0 +1,164 @@
+#ifndef FAKETABLETD_OUTPUT_H__
+#define FAKETABLETD_OUTPUT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <linux/input.h>
+#include <linux/io_uring.h>
+
+#include "frame.h"
+#include "sink.h"
+
+// How many writes can be on their way at once. Each one is a whole frame
+// for a single device, so this is plenty
+#define OUTPUT_QUEUE_DEPTH          64
+#define OUTPUT_MAX_FILES            4
+
+// How many frames can wait for a busy device (one that said EAGAIN), for
+// all of them together
+#define OUTPUT_PENDING_DEPTH        16
+
+// What a waiting frame is worth, lowest first. Once there's no room left
+// the lowest one goes, the oldest one if there's a few. A hovering pen
+// sends its position again soon enough, one that's drawing has it show up
+// as a gap in the stroke, and relative motion and key changes aren't sent
+// again at all
+#define OUTPUT_PRIORITY_HOVER       0
+#define OUTPUT_PRIORITY_CONTACT     1
+#define OUTPUT_PRIORITY_STATE       2
+#define OUTPUT_PRIORITY_COUNT       3
+
+// Events stay here until the kernel is done with them, since the frame they
+// came from lives on the stack. file is their device's position in files
+struct output_slot_t
+{
+    uint64_t submitted;
+    size_t file;
+    size_t count;
+    struct input_event events[FRAME_MAX_EVENTS];
+};
+
+// A frame (or what's left of it) waiting for its device to take it. file
+// is its position in files
+struct output_pending_t
+{
+    size_t file;
+    int priority;
+    size_t offset;
+    size_t count;
+    struct input_event events[FRAME_MAX_EVENTS];
+};
+
+// Where a device's frames end up. With io_uring, writes for the virtual
+// devices are queued on a ring, pushed to the kernel once per frame and
+// their completions are picked up whenever we next come around, without a
+// syscall. Without it (or if the ring cannot be created) every write goes
+// out right away with write(). Only ever used from one thread at a time
+struct output_t
+{
+    // Sinks with a write of their own get every frame through it
+    const struct sink_t *sink;
+    struct sink_state_t *sink_state;
+
+    bool use_io_uring;
+    int ring_fd;
+
+    // Shared with the kernel
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size;
+    uint32_t *sq_head, *sq_tail, *sq_mask, *sq_array;
+    uint32_t *cq_head, *cq_tail, *cq_mask;
+    uint32_t sq_entries;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    struct io_uring_cqe *cqes;
+
+    // Virtual device handles (fds, unless the sink has a write). Their
+    // position is what goes in the sqe, and shadows[i] is what we last told
+    // files[i]
+    int files[OUTPUT_MAX_FILES];
+    size_t file_count;
+    struct frame_shadow_t shadows[OUTPUT_MAX_FILES];
+
+    // queued is what we haven't told the kernel about yet. busy_files has
+    // a bit for each of files with a write on its way. There's never more
+    // than one per device, or a later frame could get there first if an
+    // earlier one comes back with EAGAIN
+    uint32_t queued;
+    uint32_t in_flight;
+    uint32_t busy_files;
+    uint32_t free_slots[OUTPUT_QUEUE_DEPTH];
+    size_t free_count;
+
+    // Frames held back for busy devices (or ones still waiting on io_uring),
+    // oldest first in pending_order. pending_files has a bit for each of
+    // files with any of them, and every frame for those goes behind them
+    // until they're out
+    size_t pending_order[OUTPUT_PENDING_DEPTH];
+    size_t pending_free[OUTPUT_PENDING_DEPTH];
+    size_t pending_count;
+    uint32_t pending_files;
+
+    // When the last frame was done being decoded, and when it was done
+    // being written (or submitted). Left alone by frames with nothing to
+    // write, so whoever cares zeroes them before running the driver
+    uint64_t decoded_at;
+    uint64_t emitted_at;
+
+    // Submission to completion time (as seen by us, so reaping late counts)
+    // and how many writes were on their way whenever one was queued
+    uint64_t writes;
+    uint64_t errors;
+    uint64_t completions;
+    uint64_t latency_total;
+    uint64_t latency_max;
+    uint64_t depth_total;
+    uint32_t depth_max;
+
+    // Frames that had to wait, and frames that never made it because
+    // there was no room left for them, by priority
+    uint64_t deferred;
+    uint64_t dropped[OUTPUT_PRIORITY_COUNT];
+    size_t pending_max;
+
+    struct output_slot_t slots[OUTPUT_QUEUE_DEPTH];
+    struct output_pending_t pending[OUTPUT_PENDING_DEPTH];
+};
+
+// Resets the engine to plain writes. Safe to output_close right after
+void output_init(struct output_t *output);
+
+// Starts keeping track of the handles sink gave out (negative ones are
+// skipped). If use_io_uring is set and the handles are fds, also sets up
+// the io_uring ring with them registered. Falls back to plain writes if it
+// can't, so this only warns
+void output_setup(struct output_t *output, const struct sink_t *sink, struct sink_state_t *sink_state, bool use_io_uring, const int *fds, size_t count);
+
+// Shadow state for fd, or NULL if it isn't one of ours
+struct frame_shadow_t *output_find_shadow(struct output_t *output, int fd);
+
+// Writes (or queues) count events for fd. Whatever a busy device doesn't
+// take right away waits for it to have room, and whatever it won't take at
+// all is counted and dropped, so this only fails if io_uring itself does
+int output_write(struct output_t *output, int fd, const struct input_event *events, size_t count);
+
+// Sends every waiting frame its device has room for. Whoever runs the
+// output should call this whenever one of the files with a bit set in
+// pending_files is writable, and whenever ring_fd is readable while one of
+// them is also in busy_files
+void output_flush(struct output_t *output);
+
+// Pushes every queued write to the kernel in a single call
+int output_submit(struct output_t *output);
+
+// Picks up whatever completed so far, without blocking
+void output_reap(struct output_t *output);
+
+// Waits for everything on its way
+void output_drain(struct output_t *output);
+
+void output_close(struct output_t *output);
+void output_print_stats(const struct output_t *output, const char *name);
+
+#endif
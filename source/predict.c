@@ -0,0 +1,14 @@
+#include "predict.h"
+#include "utilities.h"
+
+int predict_setup(struct predict_t *predict, float lead_ms)
+{
+    if(lead_ms < 0 || lead_ms > PREDICT_MAX_LEAD_MS)
+    {
+        __WARNING("cannot predict %.1f ms ahead, it has to be between 0 and %.0f ms", lead_ms, PREDICT_MAX_LEAD_MS);
+        return -1;
+    }
+
+    predict->lead_us = (int64_t)(lead_ms * 1000.0f + 0.5f);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef FAKETABLETD_PREDICT_H__
+#define FAKETABLETD_PREDICT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Guesses where the pen will be a little ahead of time, to make up for
+// the time its events take to show up on screen. Velocity and acceleration
+// come from the last PREDICT_HISTORY positions, the newer half against the
+// older one. Velocities are in units per ms and accelerations in units per
+// ms squared, both with PREDICT_SHIFT fractional bits. Times are in us
+#define PREDICT_SHIFT               16
+
+// Must be a power of two
+#define PREDICT_HISTORY             4
+
+// Reports further apart than this start the history over
+#define PREDICT_MAX_PERIOD_US       50000
+
+// Predicting further ahead than this is guessing
+#define PREDICT_MAX_LEAD_MS         50.0f
+
+struct predict_t
+{
+    int64_t lead_us;
+};
+
+struct predict_sample_t
+{
+    int64_t time;
+    int32_t x;
+    int32_t y;
+};
+
+// Per device, kept along with the rest of the driver's state. head is
+// where the newest sample is
+struct predict_state_t
+{
+    size_t count;
+    size_t head;
+    bool touching;
+    struct predict_sample_t samples[PREDICT_HISTORY];
+};
+
+// lead_ms is how far ahead to predict. Returns -1 if it's negative or too
+// far ahead
+int predict_setup(struct predict_t *predict, float lead_ms);
+
+static inline void predict_reset(struct predict_state_t *state)
+{
+    state->count = 0;
+}
+
+static inline const struct predict_sample_t *predict_sample(const struct predict_state_t *state, size_t age)
+{
+    return &state->samples[(state->head - age) & (PREDICT_HISTORY - 1)];
+}
+
+// Where an axis will be lead_us after the newest sample, going by samples
+// newest, middle and oldest
+static inline int64_t predict_axis(int32_t newest, int32_t middle, int32_t oldest,
+    int64_t recent_us, int64_t older_us, int64_t span_us, int64_t lead_us, bool has_acceleration)
+{
+    int64_t velocity = ((int64_t)(newest - middle) << PREDICT_SHIFT) * 1000 / recent_us, acceleration = 0;
+
+    // Both velocities are averages, the recent one being what the pen did
+    // half way through the recent part. Acceleration brings it forward to
+    // the newest sample
+    if(has_acceleration)
+    {
+        acceleration = (velocity - ((int64_t)(middle - oldest) << PREDICT_SHIFT) * 1000 / older_us) * 2000 / span_us;
+        velocity += acceleration * recent_us / 2000;
+    }
+
+    return newest + ((velocity * lead_us / 1000 + acceleration * lead_us / 1000 * lead_us / 2000) >> PREDICT_SHIFT);
+}
+
+static inline int32_t predict_clamp(int64_t value, int32_t max)
+{
+    return value < 0 ? 0 : value > max ? max : (int32_t)value;
+}
+
+// Records the pen's position (in range, touching or not) and replaces it
+// with where it should be by lead_us from now, within [0, max_x] and
+// [0, max_y]. Touching down or lifting starts over, since the pen's motion
+// changes with it, and so does the caller whenever the pen leaves
+static inline void predict_apply(const struct predict_t *predict, struct predict_state_t *state, uint64_t timestamp,
+    bool touching, int32_t max_x, int32_t max_y, int32_t *x, int32_t *y)
+{
+    int64_t time = (int64_t)(timestamp / 1000), recent_us = 0, older_us = 0, span_us = 0;
+    const struct predict_sample_t *newest = NULL, *middle = NULL, *oldest = NULL;
+
+    if(state->count > 0 && (touching != state->touching || time <= predict_sample(state, 0)->time ||
+        time - predict_sample(state, 0)->time > PREDICT_MAX_PERIOD_US))
+        predict_reset(state);
+
+    state->touching = touching;
+    state->head = (state->head + 1) & (PREDICT_HISTORY - 1);
+    state->samples[state->head] = (struct predict_sample_t){ .time = time, .x = *x, .y = *y };
+    if(state->count < PREDICT_HISTORY)
+        state->count++;
+
+    // A straight line needs two points, and a curve three
+    if(state->count < 2 || predict->lead_us == 0)
+        return;
+
+    newest = predict_sample(state, 0);
+    middle = predict_sample(state, state->count / 2);
+    oldest = predict_sample(state, state->count - 1);
+    recent_us = newest->time - middle->time;
+    older_us = middle->time - oldest->time;
+    span_us = newest->time - oldest->time;
+
+    *x = predict_clamp(predict_axis(newest->x, middle->x, oldest->x, recent_us, older_us, span_us, predict->lead_us, state->count > 2), max_x);
+    *y = predict_clamp(predict_axis(newest->y, middle->y, oldest->y, recent_us, older_us, span_us, predict->lead_us, state->count > 2), max_y);
+}
+
+#endif
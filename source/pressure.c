@@ -0,0 +1,99 @@
+#include <math.h>
+
+#include "pressure.h"
+#include "utilities.h"
+
+// Bisection steps to find where on the bezier each level sits. Each one
+// halves the error, so this is way past what 8192 levels can tell apart
+#define PRESSURE_BEZIER_STEPS       32
+
+// One coordinate of a cubic bezier going from 0 to 1 through c1 and c2
+static double bezier(double c1, double c2, double t)
+{
+    double s = 1.0 - t;
+    return 3.0 * s * s * t * c1 + 3.0 * s * t * t * c2 + t * t * t;
+}
+
+// Where the curve is at x. The x part only ever goes up as long as both
+// control points' x are between 0 and 1, so there's only one answer
+static double bezier_at(const struct pressure_curve_t *curve, double x)
+{
+    double low = 0.0, high = 1.0, t = 0.5;
+
+    for(int i = 0; i < PRESSURE_BEZIER_STEPS; i++)
+    {
+        t = (low + high) / 2.0;
+        if(bezier(curve->x1, curve->x2, t) < x)
+            low = t;
+        else
+            high = t;
+    }
+    return bezier(curve->y1, curve->y2, (low + high) / 2.0);
+}
+
+int pressure_parse_bezier(struct pressure_curve_t *curve, const char *str)
+{
+    if(sscanf(str, "%f,%f,%f,%f", &curve->x1, &curve->y1, &curve->x2, &curve->y2) != 4)
+    {
+        __WARNING("invalid pressure curve \"%s\", it has to be x1,y1,x2,y2", str);
+        return -1;
+    }
+    if(curve->x1 < 0 || curve->x1 > 1 || curve->x2 < 0 || curve->x2 > 1)
+    {
+        __WARNING("invalid pressure curve \"%s\", both x have to be between 0 and 1", str);
+        return -1;
+    }
+
+    curve->type = PRESSURE_CURVE_BEZIER;
+    return 0;
+}
+
+int pressure_compile(struct pressure_table_t *table, const struct pressure_curve_t *curve)
+{
+    double x = 0, y = 0;
+
+    if(curve->min < 0 || curve->max > PRESSURE_MAX || curve->min >= curve->max)
+    {
+        __WARNING("invalid pressure thresholds %d and %d, they have to go up from 0 to %d", curve->min, curve->max, PRESSURE_MAX);
+        return -1;
+    }
+    if(curve->type == PRESSURE_CURVE_GAMMA && !(curve->gamma > 0))
+    {
+        __WARNING("invalid pressure gamma %.3f, it has to be above 0", curve->gamma);
+        return -1;
+    }
+
+    for(int32_t i = 0; i < PRESSURE_LEVELS; i++)
+    {
+        x = (double)(i - curve->min) / (curve->max - curve->min);
+        x = x < 0 ? 0 : x > 1 ? 1 : x;
+
+        switch (curve->type)
+        {
+        case PRESSURE_CURVE_GAMMA:
+            y = pow(x, curve->gamma);
+            break;
+        case PRESSURE_CURVE_BEZIER:
+            y = bezier_at(curve, x);
+            break;
+        default:
+            y = x;
+            break;
+        }
+
+        // A bezier can overshoot either end
+        y = y < 0 ? 0 : y > 1 ? 1 : y;
+        table->levels[i] = (uint16_t)(y * PRESSURE_MAX + 0.5);
+    }
+
+    // Anything the pen reports past min still counts as touching, even if
+    // the curve starts out flat
+    for(int32_t i = curve->min + 1; i < PRESSURE_LEVELS && table->levels[i] == 0; i++)
+        table->levels[i] = 1;
+    return 0;
+}
+
+void pressure_publish(struct pressure_t *pressure, const struct pressure_table_t *table)
+{
+    atomic_store_explicit(&pressure->table, table, memory_order_release);
+}
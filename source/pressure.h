@@ -0,0 +1,73 @@
+#ifndef FAKETABLETD_PRESSURE_H__
+#define FAKETABLETD_PRESSURE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Every pressure level the virtual pen knows about, 0 to
+// GENERIC_PEN_MAX_PRESSURE
+#define PRESSURE_LEVELS             8192
+#define PRESSURE_MAX                (PRESSURE_LEVELS - 1)
+
+#define PRESSURE_CURVE_NONE         0
+#define PRESSURE_CURVE_GAMMA        1
+#define PRESSURE_CURVE_BEZIER       2
+
+// How pressure should feel, as read from the config file. Whatever the
+// pen reports below min doesn't count, anything from max up is full
+// pressure, and what's in between goes through the curve
+struct pressure_curve_t
+{
+    int type;
+    int32_t min;
+    int32_t max;
+
+    // Output is input to the power of gamma, both from 0 to 1. Below 1
+    // is softer, above it is firmer
+    float gamma;
+
+    // Control points of a cubic bezier going from 0,0 to 1,1, the same way
+    // CSS' cubic-bezier() takes them. Both x have to be between 0 and 1
+    float x1, y1;
+    float x2, y2;
+};
+
+// What each pressure level goes out as
+struct pressure_table_t
+{
+    uint16_t levels[PRESSURE_LEVELS];
+};
+
+// Where the pen looks its table up, shared by every device. table is NULL
+// while pressure goes out as it comes in, and it can be swapped while
+// reports are going through
+struct pressure_t
+{
+    _Atomic(const struct pressure_table_t *) table;
+};
+
+// Parses a bezier curve's control points, as "x1,y1,x2,y2". Returns -1 if
+// it's not four numbers or the curve turns back on itself
+int pressure_parse_bezier(struct pressure_curve_t *curve, const char *str);
+
+// Works out the whole table for curve. Returns -1 if the thresholds are
+// out of order or the curve makes no sense
+int pressure_compile(struct pressure_table_t *table, const struct pressure_curve_t *curve);
+
+// Makes table the one every pen uses from its next report on, NULL going
+// back to raw pressure. Tables handed over here have to stay around until
+// at least the next swap, since a pen might still be looking at them
+void pressure_publish(struct pressure_t *pressure, const struct pressure_table_t *table);
+
+static inline int32_t pressure_apply(const struct pressure_t *pressure, int32_t value)
+{
+    const struct pressure_table_t *table = atomic_load_explicit(&pressure->table, memory_order_acquire);
+
+    if(table == NULL)
+        return value;
+    return table->levels[value < 0 ? 0 : value > PRESSURE_MAX ? PRESSURE_MAX : value];
+}
+
+#endif
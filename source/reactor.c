@@ -0,0 +1,349 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <poll.h>
+
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "reactor.h"
+#include "utilities.h"
+
+static struct reactor_handler_t *find_handler(struct reactor_t *reactor, int fd)
+{
+    for(size_t i = 0; i < REACTOR_MAX_HANDLERS; i++)
+        if(reactor->handlers[i].type != REACTOR_HANDLER_FREE && reactor->handlers[i].fd == fd)
+            return &reactor->handlers[i];
+    return NULL;
+}
+
+static struct reactor_handler_t *register_handler(struct reactor_t *reactor, int type, int fd, uint32_t events)
+{
+    struct reactor_handler_t *handler = NULL;
+    struct epoll_event event = (struct epoll_event){};
+
+    for(size_t i = 0; i < REACTOR_MAX_HANDLERS && handler == NULL; i++)
+        if(reactor->handlers[i].type == REACTOR_HANDLER_FREE && !reactor->handlers[i].stale)
+            handler = &reactor->handlers[i];
+
+    if(handler == NULL)
+    {
+        __ERROR("cannot watch more than %d file descriptors", REACTOR_MAX_HANDLERS);
+        return NULL;
+    }
+
+    event.events = events;
+    event.data.ptr = handler;
+    if(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        __ERROR("cannot watch file descriptor %d: %s", fd, strerror(errno));
+        return NULL;
+    }
+
+    *handler = (struct reactor_handler_t){ .type = type, .fd = fd };
+    return handler;
+}
+
+static void release_handler(struct reactor_t *reactor, struct reactor_handler_t *handler)
+{
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, handler->fd, NULL);
+
+    *handler = (struct reactor_handler_t){ .type = REACTOR_HANDLER_FREE, .fd = -1 };
+    handler->stale = reactor->dispatching;
+}
+
+int reactor_init(struct reactor_t *reactor)
+{
+    *reactor = (struct reactor_t){};
+
+    for(size_t i = 0; i < REACTOR_MAX_HANDLERS; i++)
+        reactor->handlers[i].fd = -1;
+
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(reactor->epoll_fd < 0)
+    {
+        __ERROR("cannot create epoll instance: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+void reactor_destroy(struct reactor_t *reactor)
+{
+    struct reactor_handler_t *handler = NULL;
+
+    reactor_detach_usb(reactor);
+
+    for(size_t i = 0; i < REACTOR_MAX_HANDLERS; i++)
+    {
+        handler = &reactor->handlers[i];
+
+        // We own timer and signal fds, everything else belongs to the caller
+        if(handler->type == REACTOR_HANDLER_TIMER || handler->type == REACTOR_HANDLER_SIGNAL)
+            close(handler->fd);
+        if(handler->type != REACTOR_HANDLER_FREE)
+            release_handler(reactor, handler);
+    }
+
+    if(reactor->epoll_fd >= 0)
+        close(reactor->epoll_fd);
+    reactor->epoll_fd = -1;
+}
+
+int reactor_add_fd(struct reactor_t *reactor, int fd, uint32_t events, reactor_fd_callback_t callback, void *user_data)
+{
+    struct reactor_handler_t *handler = register_handler(reactor, REACTOR_HANDLER_FD, fd, events);
+    if(handler == NULL)
+        return -1;
+
+    handler->fd_callback = callback;
+    handler->user_data = user_data;
+    return 0;
+}
+
+int reactor_modify_fd(struct reactor_t *reactor, int fd, uint32_t events)
+{
+    struct reactor_handler_t *handler = find_handler(reactor, fd);
+    struct epoll_event event = (struct epoll_event){ .events = events };
+
+    if(handler == NULL)
+        return -1;
+
+    event.data.ptr = handler;
+    return epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, fd, &event);
+}
+
+void reactor_remove_fd(struct reactor_t *reactor, int fd)
+{
+    struct reactor_handler_t *handler = find_handler(reactor, fd);
+    if(handler == NULL)
+        return;
+
+    if(handler->type == REACTOR_HANDLER_TIMER || handler->type == REACTOR_HANDLER_SIGNAL)
+        close(handler->fd);
+    release_handler(reactor, handler);
+}
+
+int reactor_set_timer(struct reactor_t *reactor, int fd, uint64_t first_ns, uint64_t interval_ns)
+{
+    struct itimerspec spec = (struct itimerspec){
+        .it_value = {
+            .tv_sec = first_ns / 1000000000ULL,
+            .tv_nsec = first_ns % 1000000000ULL
+        },
+        .it_interval = {
+            .tv_sec = interval_ns / 1000000000ULL,
+            .tv_nsec = interval_ns % 1000000000ULL
+        }
+    };
+
+    // A zero it_value would disarm the timer
+    if(first_ns == 0)
+        spec.it_value.tv_nsec = 1;
+
+    if(timerfd_settime(fd, 0, &spec, NULL) < 0)
+    {
+        __ERROR("cannot arm timer: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int reactor_add_timer(struct reactor_t *reactor, uint64_t first_ns, uint64_t interval_ns, reactor_timer_callback_t callback, void *user_data)
+{
+    int fd = -1;
+    struct reactor_handler_t *handler = NULL;
+
+    fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(fd < 0)
+    {
+        __ERROR("cannot create timer: %s", strerror(errno));
+        return -1;
+    }
+
+    if(reactor_set_timer(reactor, fd, first_ns, interval_ns) < 0 ||
+        (handler = register_handler(reactor, REACTOR_HANDLER_TIMER, fd, EPOLLIN)) == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    handler->timer_callback = callback;
+    handler->user_data = user_data;
+
+    return fd;
+}
+
+int reactor_add_signals(struct reactor_t *reactor, const int *signals, size_t count, reactor_signal_callback_t callback, void *user_data)
+{
+    int fd = -1;
+    sigset_t mask;
+    struct reactor_handler_t *handler = NULL;
+
+    sigemptyset(&mask);
+    for(size_t i = 0; i < count; i++)
+        sigaddset(&mask, signals[i]);
+
+    if(pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0 || (fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+    {
+        __ERROR("cannot create signal file descriptor: %s", strerror(errno));
+        return -1;
+    }
+
+    if((handler = register_handler(reactor, REACTOR_HANDLER_SIGNAL, fd, EPOLLIN)) == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    handler->signal_callback = callback;
+    handler->user_data = user_data;
+
+    return 0;
+}
+
+static void usb_pollfd_added(int fd, short events, void *user_data)
+{
+    struct reactor_t *reactor = (struct reactor_t *)user_data;
+    uint32_t epoll_events = 0;
+
+    if(events & POLLIN) epoll_events |= EPOLLIN;
+    if(events & POLLOUT) epoll_events |= EPOLLOUT;
+
+    register_handler(reactor, REACTOR_HANDLER_USB, fd, epoll_events);
+}
+
+static void usb_pollfd_removed(int fd, void *user_data)
+{
+    struct reactor_t *reactor = (struct reactor_t *)user_data;
+    struct reactor_handler_t *handler = find_handler(reactor, fd);
+
+    if(handler != NULL && handler->type == REACTOR_HANDLER_USB)
+        release_handler(reactor, handler);
+}
+
+int reactor_attach_usb(struct reactor_t *reactor, libusb_context *usb_context)
+{
+    const struct libusb_pollfd **pollfds = NULL;
+
+    reactor_detach_usb(reactor);
+
+    if((pollfds = libusb_get_pollfds(usb_context)) == NULL)
+    {
+        __ERROR("cannot get libusb file descriptors");
+        return -1;
+    }
+
+    reactor->usb_context = usb_context;
+    for(size_t i = 0; pollfds[i] != NULL; i++)
+        usb_pollfd_added(pollfds[i]->fd, pollfds[i]->events, reactor);
+    libusb_free_pollfds(pollfds);
+
+    libusb_set_pollfd_notifiers(usb_context, usb_pollfd_added, usb_pollfd_removed, reactor);
+    reactor->usb_handles_timeouts = libusb_pollfds_handle_timeouts(usb_context) == 1;
+
+    return 0;
+}
+
+void reactor_detach_usb(struct reactor_t *reactor)
+{
+    if(reactor->usb_context == NULL)
+        return;
+
+    libusb_set_pollfd_notifiers(reactor->usb_context, NULL, NULL, NULL);
+    for(size_t i = 0; i < REACTOR_MAX_HANDLERS; i++)
+        if(reactor->handlers[i].type == REACTOR_HANDLER_USB)
+            release_handler(reactor, &reactor->handlers[i]);
+
+    reactor->usb_context = NULL;
+    reactor->usb_pending = false;
+}
+
+static void dispatch(struct reactor_t *reactor, struct reactor_handler_t *handler, uint32_t events)
+{
+    uint64_t expirations = 0;
+    struct signalfd_siginfo info;
+
+    switch (handler->type)
+    {
+    case REACTOR_HANDLER_FD:
+        handler->fd_callback(reactor, handler->fd, events, handler->user_data);
+        break;
+
+    case REACTOR_HANDLER_TIMER:
+        if(read(handler->fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+            handler->timer_callback(reactor, expirations, handler->user_data);
+        break;
+
+    case REACTOR_HANDLER_SIGNAL:
+        while(handler->type == REACTOR_HANDLER_SIGNAL && read(handler->fd, &info, sizeof(info)) == sizeof(info))
+            handler->signal_callback(reactor, info.ssi_signo, handler->user_data);
+        break;
+
+    // libusb wants to see all of its fds at once, so we only take note
+    // here and let it handle everything after the batch
+    case REACTOR_HANDLER_USB:
+        reactor->usb_pending = true;
+        break;
+
+    default:
+        break;
+    }
+}
+
+int reactor_run_once(struct reactor_t *reactor, int timeout_ms)
+{
+    int count = 0, ret = 0;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    struct reactor_handler_t *handler = NULL;
+    struct timeval usb_timeout = (struct timeval){};
+
+    // libusb versions that can't hand us a timerfd need to be woken up
+    // for their own timeouts
+    if(reactor->usb_context != NULL && !reactor->usb_handles_timeouts &&
+        libusb_get_next_timeout(reactor->usb_context, &usb_timeout) == 1)
+    {
+        int usb_timeout_ms = usb_timeout.tv_sec * 1000 + (usb_timeout.tv_usec + 999) / 1000;
+        if(timeout_ms < 0 || usb_timeout_ms < timeout_ms)
+        {
+            timeout_ms = usb_timeout_ms;
+            reactor->usb_pending = true;
+        }
+    }
+
+    count = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, timeout_ms);
+    if(count < 0)
+    {
+        if(errno == EINTR)
+            return 0;
+        __ERROR("cannot wait for events: %s", strerror(errno));
+        return -1;
+    }
+
+    reactor->dispatching = true;
+    for(int i = 0; i < count; i++)
+    {
+        handler = (struct reactor_handler_t *)events[i].data.ptr;
+        if(handler->type == REACTOR_HANDLER_FREE)
+            continue;
+        dispatch(reactor, handler, events[i].events);
+    }
+    reactor->dispatching = false;
+
+    for(size_t i = 0; i < REACTOR_MAX_HANDLERS; i++)
+        reactor->handlers[i].stale = false;
+
+    // Handle every transfer that completed during this wakeup in one go
+    if(reactor->usb_pending && reactor->usb_context != NULL)
+    {
+        reactor->usb_pending = false;
+        usb_timeout = (struct timeval){};
+        ret = libusb_handle_events_timeout_completed(reactor->usb_context, &usb_timeout, NULL);
+        if(ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
+        {
+            __ERROR("usb event handling error: %s", libusb_strerror(ret));
+            return -1;
+        }
+    }
+
+    return count;
+}
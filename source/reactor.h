@@ -0,0 +1,88 @@
+#ifndef FAKETABLETD_REACTOR_H__
+#define FAKETABLETD_REACTOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+
+#include <sys/epoll.h>
+#include <libusb-1.0/libusb.h>
+
+#define REACTOR_MAX_HANDLERS        64
+#define REACTOR_MAX_EVENTS          32
+
+#define REACTOR_HANDLER_FREE        0
+#define REACTOR_HANDLER_FD          1
+#define REACTOR_HANDLER_TIMER       2
+#define REACTOR_HANDLER_SIGNAL      3
+#define REACTOR_HANDLER_USB         4
+
+struct reactor_t;
+
+typedef void (*reactor_fd_callback_t)(struct reactor_t *reactor, int fd, uint32_t events, void *user_data);
+typedef void (*reactor_timer_callback_t)(struct reactor_t *reactor, uint64_t expirations, void *user_data);
+typedef void (*reactor_signal_callback_t)(struct reactor_t *reactor, int signal, void *user_data);
+
+struct reactor_handler_t
+{
+    int type;
+    int fd;
+
+    // Set on handlers removed while dispatching, so a stale event from the
+    // same batch doesn't end up on a handler that reused the slot
+    bool stale;
+
+    union
+    {
+        reactor_fd_callback_t fd_callback;
+        reactor_timer_callback_t timer_callback;
+        reactor_signal_callback_t signal_callback;
+    };
+    void *user_data;
+};
+
+// Single threaded epoll loop. Everything the daemon waits on (libusb's
+// file descriptors, signals, timers and any other fd) goes through here,
+// so one epoll_wait wakes us up for every source that is ready
+struct reactor_t
+{
+    int epoll_fd;
+    bool dispatching;
+
+    libusb_context *usb_context;
+    bool usb_pending;
+    bool usb_handles_timeouts;
+
+    struct reactor_handler_t handlers[REACTOR_MAX_HANDLERS];
+};
+
+int reactor_init(struct reactor_t *reactor);
+void reactor_destroy(struct reactor_t *reactor);
+
+int reactor_add_fd(struct reactor_t *reactor, int fd, uint32_t events, reactor_fd_callback_t callback, void *user_data);
+int reactor_modify_fd(struct reactor_t *reactor, int fd, uint32_t events);
+void reactor_remove_fd(struct reactor_t *reactor, int fd);
+
+// Returns a timerfd that fires after first_ns and then every interval_ns
+// (0 for a one-shot timer). Remove it with reactor_remove_fd
+int reactor_add_timer(struct reactor_t *reactor, uint64_t first_ns, uint64_t interval_ns, reactor_timer_callback_t callback, void *user_data);
+
+// Re-arms a timer returned by reactor_add_timer
+int reactor_set_timer(struct reactor_t *reactor, int fd, uint64_t first_ns, uint64_t interval_ns);
+
+// Blocks the given signals on the calling thread and delivers them through a
+// signalfd instead. Call this before any other thread is created so they
+// inherit the mask
+int reactor_add_signals(struct reactor_t *reactor, const int *signals, size_t count, reactor_signal_callback_t callback, void *user_data);
+
+// Registers libusb's file descriptors (and keeps track of new ones), so
+// transfers complete from within reactor_run_once
+int reactor_attach_usb(struct reactor_t *reactor, libusb_context *usb_context);
+void reactor_detach_usb(struct reactor_t *reactor);
+
+// Waits up to timeout_ms (-1 for ever) and dispatches every ready source in
+// one batch. libusb events are handled once per batch. Returns the number of
+// events handled or -1 on error
+int reactor_run_once(struct reactor_t *reactor, int timeout_ms);
+
+#endif
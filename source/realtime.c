@@ -0,0 +1,114 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+
+#include <sys/mman.h>
+
+#include "realtime.h"
+#include "utilities.h"
+
+void realtime_setup_process(const struct realtime_options_t *options)
+{
+    if(!options->enabled)
+        return;
+
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        __WARNING("cannot lock memory, pages might still be swapped out: %s", strerror(errno));
+    else
+        __INFO("locked all memory pages");
+}
+
+// Touch the stack now so the first deep call on the hot path doesn't fault
+static void __attribute__((noinline)) prefault_stack()
+{
+    volatile uint8_t stack[REALTIME_STACK_PREFAULT];
+
+    for(size_t i = 0; i < sizeof(stack); i += 4096)
+        stack[i] = 0;
+}
+
+void realtime_setup_thread(const struct realtime_options_t *options, const char *name)
+{
+    int ret = 0;
+    cpu_set_t cpus;
+    struct sched_param param = (struct sched_param){};
+
+    if(!options->enabled)
+        return;
+
+    prefault_stack();
+
+    param.sched_priority = options->priority;
+    if((ret = pthread_setschedparam(pthread_self(), options->policy, &param)) != 0)
+        __WARNING("cannot use realtime scheduling for %s, running it as a regular thread: %s", name, strerror(ret));
+    else
+        __INFO(
+            "running %s under %s with priority %d", name, 
+            options->policy == SCHED_RR ? "SCHED_RR" : "SCHED_FIFO", options->priority
+        );
+
+    if(options->cpu_count == 0)
+        return;
+
+    CPU_ZERO(&cpus);
+    for(size_t i = 0; i < options->cpu_count; i++)
+        CPU_SET(options->cpus[i], &cpus);
+
+    if((ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) != 0)
+        __WARNING("cannot pin %s to the requested cpus: %s", name, strerror(ret));
+}
+
+int realtime_parse_policy(const char *str)
+{
+    if(strcmp(str, "fifo") == 0)
+        return SCHED_FIFO;
+    if(strcmp(str, "rr") == 0)
+        return SCHED_RR;
+    return -1;
+}
+
+static void latency_probe_callback(struct reactor_t *reactor, uint64_t expirations, void *user_data)
+{
+    struct latency_probe_t *probe = (struct latency_probe_t *)user_data;
+    uint64_t now = get_time_ns(), late = 0;
+
+    // If we missed expirations, measure against the last one we missed
+    probe->expected += (expirations - 1) * REALTIME_PROBE_INTERVAL_MS * 1000000ULL;
+    late = now > probe->expected ? now - probe->expected : 0;
+
+    probe->samples++;
+    probe->total += late;
+    probe->max = MAX(probe->max, late);
+
+    probe->expected += REALTIME_PROBE_INTERVAL_MS * 1000000ULL;
+}
+
+int latency_probe_start(struct latency_probe_t *probe, struct reactor_t *reactor)
+{
+    const uint64_t interval = REALTIME_PROBE_INTERVAL_MS * 1000000ULL;
+
+    *probe = (struct latency_probe_t){};
+    probe->expected = get_time_ns() + interval;
+    probe->timer = reactor_add_timer(reactor, interval, interval, latency_probe_callback, probe);
+
+    return probe->timer < 0 ? -1 : 0;
+}
+
+void latency_probe_stop(struct latency_probe_t *probe, struct reactor_t *reactor)
+{
+    if(probe->timer >= 0)
+        reactor_remove_fd(reactor, probe->timer);
+    probe->timer = -1;
+}
+
+void latency_probe_print(const struct latency_probe_t *probe, const char *name)
+{
+    if(probe->samples == 0)
+        return;
+
+    __INFO(
+        "%s scheduling latency: %.1f us average, %.1f us max over %llu wake ups", name,
+        probe->total / (double)probe->samples / 1e3, probe->max / 1e3,
+        (unsigned long long)probe->samples
+    );
+}
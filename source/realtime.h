@@ -0,0 +1,57 @@
+#ifndef FAKETABLETD_REALTIME_H__
+#define FAKETABLETD_REALTIME_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+
+#include "reactor.h"
+
+#define REALTIME_MAX_CPUS           16
+#define REALTIME_DEFAULT_PRIORITY   50
+#define REALTIME_DEFAULT_POLICY     SCHED_FIFO
+
+// How much stack we touch up front so the hot path never page faults on it
+#define REALTIME_STACK_PREFAULT     (64 * 1024)
+
+// How often the latency probe wakes up to see how late it was
+#define REALTIME_PROBE_INTERVAL_MS  100
+
+struct realtime_options_t
+{
+    bool enabled;
+    bool probe;
+
+    int policy;
+    int priority;
+
+    int cpus[REALTIME_MAX_CPUS];
+    size_t cpu_count;
+};
+
+// Measures how late a periodic timer fires, which is pretty much how long
+// the thread running the reactor waits to be scheduled
+struct latency_probe_t
+{
+    int timer;
+    uint64_t expected;
+
+    uint64_t samples;
+    uint64_t total;
+    uint64_t max;
+};
+
+// Locks every current and future page in memory. Only needs to be called once
+void realtime_setup_process(const struct realtime_options_t *options);
+
+// Applies the scheduling policy and cpu set to the calling thread and
+// prefaults its stack. Failures are only warned about
+void realtime_setup_thread(const struct realtime_options_t *options, const char *name);
+
+int realtime_parse_policy(const char *str);
+
+int latency_probe_start(struct latency_probe_t *probe, struct reactor_t *reactor);
+void latency_probe_stop(struct latency_probe_t *probe, struct reactor_t *reactor);
+void latency_probe_print(const struct latency_probe_t *probe, const char *name);
+
+#endif
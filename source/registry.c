@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "registry.h"
+#include "utilities.h"
+
+#include "drivers/generic/generic.h"
+#include "drivers/model/model.h"
+#include "drivers/rdesc/rdesc.h"
+
+#define REGISTRY_LINE_SIZE          256
+
+static const struct driver_profile_t profiles[] = 
+{
+    // One per model in models.def
+#define MODEL(_name, ...)                                       \
+    {                                                           \
+        .name                   = #_name,                       \
+        .create_virtual_pad     = generic_create_virtual_pad,   \
+        .create_virtual_pen     = _name##_create_virtual_pen,   \
+        .process_raw_input      = _name##_process_raw_input,    \
+        .pen_ranges             = &_name##_pen_ranges,          \
+    },
+#define DEVICE(_vendor_id, _product_id, _name)
+#include "drivers/models.def"
+#undef MODEL
+#undef DEVICE
+
+    {
+        .name                   = "hid",
+        .create_virtual_pad     = generic_create_virtual_pad,
+        .create_virtual_pen     = generic_create_virtual_pen,
+        .process_raw_input      = rdesc_process_raw_input,
+        .hid                    = &device_hid_profile,
+        .pen_ranges             = &generic_pen_ranges,
+    },
+    {
+        .name                   = "huion",
+        .create_virtual_pad     = generic_create_virtual_pad,
+        .create_virtual_pen     = generic_create_virtual_pen,
+        .process_raw_input      = rdesc_process_raw_input,
+        .hid                    = &huion_hid_profile,
+        .pen_ranges             = &generic_pen_ranges,
+    },
+};
+
+static struct registry_entry_t table[REGISTRY_TABLE_SIZE];
+static size_t entry_count;
+
+// Knuth's multiplicative hash, the top bits are the well mixed ones
+static inline size_t registry_hash(uint32_t key)
+{
+    return (key * 2654435761u) >> (32 - __builtin_ctz(REGISTRY_TABLE_SIZE));
+}
+
+// Either the slot holding key or the empty one where it would go
+static struct registry_entry_t *registry_find_slot(uint32_t key)
+{
+    size_t i = registry_hash(key);
+
+    while(table[i].key != 0 && table[i].key != key)
+        i = (i + 1) & (REGISTRY_TABLE_SIZE - 1);
+    return &table[i];
+}
+
+static const struct driver_profile_t *find_profile(const char *name)
+{
+    for(size_t i = 0; i < GET_LEN(profiles); i++)
+        if(strcmp(profiles[i].name, name) == 0)
+            return &profiles[i];
+    return NULL;
+}
+
+void registry_init()
+{
+    memset(table, 0, sizeof(table));
+    entry_count = 0;
+
+#define MODEL(_name, ...)
+#define DEVICE(_vendor_id, _product_id, _name)                  \
+    registry_add(_vendor_id, _product_id, _name##_get_device_name(), #_name);
+#include "drivers/models.def"
+#undef MODEL
+#undef DEVICE
+}
+
+int registry_add(uint16_t vendor_id, uint16_t product_id, const char *name, const char *profile)
+{
+    uint32_t key = REGISTRY_KEY(vendor_id, product_id);
+    struct registry_entry_t *entry = NULL;
+    const struct driver_profile_t *driver_profile = find_profile(profile);
+
+    if(driver_profile == NULL)
+    {
+        __WARNING("unknown driver profile \"%s\" for %04x:%04x", profile, vendor_id, product_id);
+        return -1;
+    }
+
+    if(key == 0)
+    {
+        __WARNING("0000:0000 is not a valid device");
+        return -1;
+    }
+
+    entry = registry_find_slot(key);
+    if(entry->key == 0)
+    {
+        if(entry_count == REGISTRY_MAX_ENTRIES)
+        {
+            __WARNING("cannot register more than %d devices", REGISTRY_MAX_ENTRIES);
+            return -1;
+        }
+        entry_count++;
+    }
+
+    entry->key = key;
+    entry->profile = driver_profile;
+    snprintf(entry->name, REGISTRY_NAME_SIZE, "%s", name);
+    return 0;
+}
+
+int registry_load_file(const char *path)
+{
+    int added = 0, line_number = 0;
+    FILE *file = NULL;
+    char line[REGISTRY_LINE_SIZE] = {0}, profile[REGISTRY_NAME_SIZE] = {0};
+    char *name = NULL, *end = NULL;
+    unsigned int vendor_id = 0, product_id = 0;
+    int consumed = 0;
+
+    if((file = fopen(path, "r")) == NULL)
+        return -1;
+
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+
+        // Comments and blank lines
+        for(name = line; isspace((unsigned char)*name); name++);
+        if(*name == '#' || *name == '\0')
+            continue;
+
+        if(sscanf(name, "%x:%x %31s %n", &vendor_id, &product_id, profile, &consumed) < 3 ||
+            vendor_id > 0xffff || product_id > 0xffff)
+        {
+            __WARNING("%s:%d: expected \"vendor:product profile [name]\"", path, line_number);
+            continue;
+        }
+
+        // Whatever is left is the name, which defaults to the profile's
+        name += consumed;
+        for(end = name + strlen(name); end > name && isspace((unsigned char)end[-1]); end--);
+        *end = '\0';
+
+        if(registry_add(vendor_id, product_id, *name != '\0' ? name : profile, profile) == 0)
+            added++;
+    }
+
+    fclose(file);
+    return added;
+}
+
+const struct registry_entry_t *registry_lookup(uint16_t vendor_id, uint16_t product_id)
+{
+    struct registry_entry_t *entry = registry_find_slot(REGISTRY_KEY(vendor_id, product_id));
+    return entry->key != 0 ? entry : NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef FAKETABLETD_REGISTRY_H__
+#define FAKETABLETD_REGISTRY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "faketabletd.h"
+#include "hid.h"
+
+struct generic_pen_ranges_t;
+
+#define REGISTRY_CONFIG_PATH        "/etc/faketabletd.devices"
+
+// Must be a power of two, and is kept at most half full so probes stay short
+#define REGISTRY_TABLE_SIZE         256
+#define REGISTRY_MAX_ENTRIES        (REGISTRY_TABLE_SIZE / 2)
+#define REGISTRY_NAME_SIZE          32
+
+#define REGISTRY_KEY(_vid, _pid)    ((uint32_t)(_vid) << 16 | (uint32_t)(_pid))
+
+// How to talk to a family of tablets. Several models can share a profile
+struct driver_profile_t
+{
+    const char *name;
+
+    create_virtual_device_callback_t create_virtual_pad;
+    create_virtual_device_callback_t create_virtual_pen;
+    process_raw_input_callback_t process_raw_input;
+
+    // Set for drivers that decode reports through a plan built from the
+    // report descriptor
+    const struct hid_profile_t *hid;
+
+    // Ranges the virtual pen reports in
+    const struct generic_pen_ranges_t *pen_ranges;
+};
+
+struct registry_entry_t
+{
+    // 0 marks an empty slot. No real device uses 0000:0000
+    uint32_t key;
+    char name[REGISTRY_NAME_SIZE];
+    const struct driver_profile_t *profile;
+};
+
+// Fills the table with the devices we know about out of the box
+void registry_init();
+
+// Adds (or replaces) a device served by the named profile
+int registry_add(uint16_t vendor_id, uint16_t product_id, const char *name, const char *profile);
+
+// Reads extra devices from a file, one per line
+//
+//  # vendor:product  profile  name
+//  256c:006d         hs610    Huion HS610
+//
+// Returns how many were added, or -1 if the file couldn't be read
+int registry_load_file(const char *path);
+
+// NULL if the device isn't supported
+const struct registry_entry_t *registry_lookup(uint16_t vendor_id, uint16_t product_id);
+
+#endif
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+
+#include "reportfile.h"
+#include "capture.h"
+#include "utilities.h"
+
+#define REPORT_FILE_LINE_SIZE           512
+#define REPORT_FILE_INITIAL_CAPACITY    1024
+
+static struct report_t *append_report(struct report_file_t *file)
+{
+    struct report_t *reports = NULL;
+
+    if(file->count == file->capacity)
+    {
+        file->capacity = file->capacity == 0 ? REPORT_FILE_INITIAL_CAPACITY : file->capacity * 2;
+        if((reports = realloc(file->reports, file->capacity * sizeof(struct report_t))) == NULL)
+        {
+            __ERROR("cannot allocate memory for %zu reports", file->capacity);
+            return NULL;
+        }
+        file->reports = reports;
+    }
+
+    file->reports[file->count] = (struct report_t){};
+    return &file->reports[file->count++];
+}
+
+// Entries look like this, with the report split over as many lines as needed
+//
+// 001:005:000:STREAM             1601324489.412413
+//  08 80 8B 2F 8C 1E 00 00 00 00 00 00
+//
+// Anything that isn't a STREAM entry (descriptors, mostly) gets skipped
+static int load_usbhid_dump(struct report_file_t *file, FILE *stream)
+{
+    char line[REPORT_FILE_LINE_SIZE] = {0}, type[32] = {0};
+    char *position = NULL, *end = NULL;
+    unsigned int bus = 0, address = 0, interface = 0;
+    unsigned long seconds = 0, microseconds = 0, value = 0;
+    uint64_t first = 0, timestamp = 0;
+    struct report_t *report = NULL;
+
+    while(fgets(line, sizeof(line), stream) != NULL)
+    {
+        if(sscanf(line, "%u:%u:%u:%31s %lu.%lu", &bus, &address, &interface, type, &seconds, &microseconds) == 6)
+        {
+            report = NULL;
+            if(strcmp(type, "STREAM") != 0)
+                continue;
+
+            timestamp = seconds * 1000000000ULL + microseconds * 1000ULL;
+            if(file->count == 0)
+                first = timestamp;
+
+            if((report = append_report(file)) == NULL)
+                return -1;
+            report->timestamp = timestamp - first;
+            continue;
+        }
+
+        if(report == NULL)
+            continue;
+
+        for(position = line; ; position = end)
+        {
+            value = strtoul(position, &end, 16);
+            if(end == position)
+                break;
+
+            if(report->size == REPORT_MAX_SIZE)
+            {
+                __WARNING("report #%zu is longer than %d bytes, cutting it short", file->count, REPORT_MAX_SIZE);
+                break;
+            }
+            report->data[report->size++] = value;
+        }
+    }
+
+    file->has_timestamps = true;
+    return 0;
+}
+
+static int load_raw(struct report_file_t *file, FILE *stream, size_t report_size)
+{
+    size_t size = 0;
+    uint8_t buffer[REPORT_MAX_SIZE];
+    struct report_t *report = NULL;
+
+    while((size = fread(buffer, 1, report_size, stream)) == report_size)
+    {
+        if((report = append_report(file)) == NULL)
+            return -1;
+        report->size = report_size;
+        memcpy(report->data, buffer, report_size);
+    }
+
+    if(size != 0)
+        __WARNING("ignoring %zu trailing bytes", size);
+
+    file->has_timestamps = false;
+    return 0;
+}
+
+static int load_capture(struct report_file_t *file, FILE *stream)
+{
+    long size = 0;
+    uint64_t count = 0, first = 0;
+    struct capture_header_t header;
+    struct capture_record_t record;
+    struct report_t *report = NULL;
+
+    if(fread(&header, sizeof(header), 1, stream) != 1)
+        return -1;
+
+    if(header.version != CAPTURE_VERSION ||
+        header.header_size != sizeof(struct capture_header_t) ||
+        header.record_size != sizeof(struct capture_record_t))
+    {
+        __ERROR("unsupported capture (version %u, %u byte records)", header.version, header.record_size);
+        return -1;
+    }
+
+    // A capture that wasn't closed properly might claim more (or less)
+    // than what's actually there
+    fseek(stream, 0, SEEK_END);
+    size = ftell(stream);
+    fseek(stream, header.header_size, SEEK_SET);
+    count = MIN(header.record_count, (uint64_t)(size - header.header_size) / header.record_size);
+
+    file->vendor_id = header.vendor_id;
+    file->product_id = header.product_id;
+
+    for(uint64_t i = 0; i < count && fread(&record, sizeof(record), 1, stream) == 1; i++)
+    {
+        if((report = append_report(file)) == NULL)
+            return -1;
+
+        if(file->count == 1)
+            first = record.timestamp;
+
+        report->timestamp = record.timestamp - first;
+        report->size = MIN(record.length, REPORT_MAX_SIZE);
+        memcpy(report->data, record.payload, report->size);
+    }
+
+    file->has_timestamps = true;
+    return 0;
+}
+
+// Our captures start with their magic, usbhid-dump entries always start
+// with bus:address:interface. Anything else has to be raw. Leaves stream
+// back at the start
+static int detect_format(FILE *stream)
+{
+    int format = REPORT_FILE_FORMAT_RAW;
+    char line[REPORT_FILE_LINE_SIZE] = {0};
+    unsigned int bus = 0, address = 0, interface = 0;
+
+    if(fread(line, 1, CAPTURE_MAGIC_SIZE, stream) == CAPTURE_MAGIC_SIZE &&
+        memcmp(line, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) == 0)
+        format = REPORT_FILE_FORMAT_CAPTURE;
+    else
+    {
+        rewind(stream);
+        if(fgets(line, sizeof(line), stream) != NULL &&
+            sscanf(line, "%u:%u:%u:", &bus, &address, &interface) == 3)
+            format = REPORT_FILE_FORMAT_USBHID_DUMP;
+    }
+    rewind(stream);
+
+    return format;
+}
+
+int report_file_read_ids(const char *path, uint16_t *vendor_id, uint16_t *product_id)
+{
+    int ret = -1;
+    FILE *stream = NULL;
+    struct capture_header_t header;
+
+    if((stream = fopen(path, "rb")) == NULL)
+        return -1;
+
+    if(detect_format(stream) == REPORT_FILE_FORMAT_CAPTURE &&
+        fread(&header, sizeof(header), 1, stream) == 1 &&
+        header.version == CAPTURE_VERSION && header.vendor_id != 0)
+    {
+        *vendor_id = header.vendor_id;
+        *product_id = header.product_id;
+        ret = 0;
+    }
+
+    fclose(stream);
+    return ret;
+}
+
+int report_file_load(struct report_file_t *file, const char *path, size_t raw_report_size)
+{
+    int ret = 0;
+    FILE *stream = NULL;
+
+    *file = (struct report_file_t){};
+
+    if(raw_report_size == 0 || raw_report_size > REPORT_MAX_SIZE)
+    {
+        __ERROR("raw reports have to be between 1 and %d bytes long", REPORT_MAX_SIZE);
+        return -1;
+    }
+
+    if((stream = fopen(path, "rb")) == NULL)
+    {
+        __ERROR("cannot open \"%s\": %s", path, strerror(errno));
+        return -1;
+    }
+
+    file->format = detect_format(stream);
+    switch (file->format)
+    {
+    case REPORT_FILE_FORMAT_CAPTURE:
+        ret = load_capture(file, stream);
+        break;
+    case REPORT_FILE_FORMAT_USBHID_DUMP:
+        ret = load_usbhid_dump(file, stream);
+        break;
+    default:
+        ret = load_raw(file, stream, raw_report_size);
+        break;
+    }
+    fclose(stream);
+
+    if(ret < 0)
+    {
+        report_file_free(file);
+        return -1;
+    }
+
+    return 0;
+}
+
+void report_file_free(struct report_file_t *file)
+{
+    free(file->reports);
+    *file = (struct report_file_t){};
+}
+
+const char *report_file_format_name(int format)
+{
+    switch (format)
+    {
+    case REPORT_FILE_FORMAT_USBHID_DUMP:
+        return "usbhid-dump";
+    case REPORT_FILE_FORMAT_RAW:
+        return "raw";
+    case REPORT_FILE_FORMAT_CAPTURE:
+        return "capture";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef FAKETABLETD_REPORTFILE_H__
+#define FAKETABLETD_REPORTFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "faketabletd.h"
+
+// Text output from "usbhid-dump -es", one STREAM entry per report
+#define REPORT_FILE_FORMAT_USBHID_DUMP  1
+
+// Reports back to back with no framing at all, like "cat /dev/hidrawN"
+// would leave them. They all have to be the same size
+#define REPORT_FILE_FORMAT_RAW          2
+
+// Our own binary capture, see capture.h
+#define REPORT_FILE_FORMAT_CAPTURE      3
+
+// Size of a raw report when nobody says otherwise (what the HS610 sends)
+#define REPORT_FILE_RAW_SIZE            12
+
+// A captured report stream, loaded up front so reading it costs nothing
+// while replaying. Timestamps are relative to the first report, and only
+// there if has_timestamps is set
+struct report_file_t
+{
+    int format;
+    bool has_timestamps;
+
+    // Only known for our own captures, 0 otherwise
+    uint16_t vendor_id;
+    uint16_t product_id;
+
+    struct report_t *reports;
+    size_t count;
+    size_t capacity;
+};
+
+int report_file_load(struct report_file_t *file, const char *path, size_t raw_report_size);
+
+// Which tablet the file at path was recorded from, without loading it.
+// Only our own captures know, so this returns -1 for anything else
+int report_file_read_ids(const char *path, uint16_t *vendor_id, uint16_t *product_id);
+void report_file_free(struct report_file_t *file);
+
+const char *report_file_format_name(int format);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef FAKETABLETD_RING_H__
+#define FAKETABLETD_RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "faketabletd.h"
+#include "utilities.h"
+
+// Must be a power of two
+#define REPORT_RING_SIZE            256
+#define CACHE_LINE_SIZE             64
+
+// Lock-free single producer/single consumer queue of reports. The producer
+// (USB side) only ever writes head, the consumer (translator) only ever
+// writes tail, and each of them lives on its own cache line so the two
+// threads don't keep stealing the line from each other
+struct report_ring_t
+{
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+
+    // Producer side counters
+    size_t pushed;
+    size_t overflows;
+    size_t high_watermark;
+
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+
+    // Set by the consumer right before it goes to sleep, so the producer
+    // only pays for a wake up when someone is actually waiting
+    _Alignas(CACHE_LINE_SIZE) atomic_bool consumer_waiting;
+
+    _Alignas(CACHE_LINE_SIZE) struct report_t slots[REPORT_RING_SIZE];
+};
+
+static inline void report_ring_init(struct report_ring_t *ring)
+{
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    atomic_store(&ring->consumer_waiting, false);
+    ring->pushed = ring->overflows = ring->high_watermark = 0;
+}
+
+static inline size_t report_ring_occupancy(struct report_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire) -
+        atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+// Producer only. Returns false (and counts an overflow) if the ring is full
+static inline bool report_ring_push(struct report_ring_t *ring, const uint8_t *data, size_t size, uint64_t timestamp)
+{
+    struct report_t *slot = NULL;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t used = head - atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if(used >= REPORT_RING_SIZE)
+    {
+        ring->overflows++;
+        return false;
+    }
+
+    slot = &ring->slots[head & (REPORT_RING_SIZE - 1)];
+    slot->timestamp = timestamp;
+    slot->size = MIN(size, REPORT_MAX_SIZE);
+    memcpy(slot->data, data, slot->size);
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    ring->pushed++;
+    if(used + 1 > ring->high_watermark)
+        ring->high_watermark = used + 1;
+    return true;
+}
+
+// Consumer only. Returns the oldest report, or NULL if the ring is empty.
+// The report stays valid until report_ring_pop
+static inline const struct report_t *report_ring_peek(struct report_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if(tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+        return NULL;
+    return &ring->slots[tail & (REPORT_RING_SIZE - 1)];
+}
+
+static inline void report_ring_pop(struct report_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+#endif
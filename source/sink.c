@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+#include "sink.h"
+#include "utilities.h"
+
+static const char *device_names[SINK_DEVICE_COUNT] = { "pad", "pen", "mouse", "keyboard" };
+
+// uinput sink
+
+static int uinput_create(struct sink_state_t *state, int kind, struct input_id *id, const char *name)
+{
+    switch (kind)
+    {
+    case SINK_DEVICE_PAD:
+        VALIDATE(state->create_virtual_pad != NULL, "cannot call empty callback \"create_virtual_pad\"");
+        return state->create_virtual_pad(id, name);
+    case SINK_DEVICE_PEN:
+        VALIDATE(state->create_virtual_pen != NULL, "cannot call empty callback \"create_virtual_pen\"");
+        return state->create_virtual_pen(id, name);
+    case SINK_DEVICE_MOUSE:
+        return create_virtual_mouse();
+    case SINK_DEVICE_KEYBOARD:
+        return create_virtual_keyboard();
+    default:
+        return -1;
+    }
+}
+
+static void uinput_destroy(struct sink_state_t *state, int handle)
+{
+    ioctl(handle, UI_DEV_DESTROY);
+    close(handle);
+}
+
+const struct sink_t uinput_sink = {
+    .name = "uinput",
+    .create = uinput_create,
+    .destroy = uinput_destroy
+};
+
+// The rest of the sinks live in memory, so the handle just tells which
+// device the events were meant for. 0 is never handed out, the drivers
+// take it as no device in places
+#define HANDLE_FROM_KIND(_kind)     ((_kind) + 1)
+#define KIND_FROM_HANDLE(_handle)   ((_handle) - 1)
+
+static int make_handle(struct sink_state_t *state, int kind, struct input_id *id, const char *name)
+{
+    if(kind < 0 || kind >= SINK_DEVICE_COUNT)
+        return -1;
+    return HANDLE_FROM_KIND(kind);
+}
+
+static void drop_handle(struct sink_state_t *state, int handle) {}
+
+// null sink
+
+static int null_write(struct sink_state_t *state, int handle, const struct input_event *events, size_t count)
+{
+    return 0;
+}
+
+const struct sink_t null_sink = {
+    .name = "null",
+    .create = make_handle,
+    .destroy = drop_handle,
+    .write = null_write
+};
+
+// memory sink
+
+static int memory_open(struct sink_state_t *state)
+{
+    if(state->records == NULL &&
+        (state->records = malloc(SINK_MEMORY_CAPACITY * sizeof(struct sink_record_t))) == NULL)
+    {
+        __ERROR("cannot allocate room for %d events", SINK_MEMORY_CAPACITY);
+        return -1;
+    }
+
+    state->record_count = state->records_dropped = 0;
+    return 0;
+}
+
+static int memory_write(struct sink_state_t *state, int handle, const struct input_event *events, size_t count)
+{
+    size_t room = SINK_MEMORY_CAPACITY - state->record_count;
+
+    if(count > room)
+    {
+        state->records_dropped += count - room;
+        count = room;
+    }
+
+    for(size_t i = 0; i < count; i++)
+        state->records[state->record_count++] = (struct sink_record_t){ .handle = handle, .event = events[i] };
+    return 0;
+}
+
+static void memory_close(struct sink_state_t *state)
+{
+    free(state->records);
+    state->records = NULL;
+    state->record_count = state->records_dropped = 0;
+}
+
+static void memory_print_stats(const struct sink_state_t *state, const char *name)
+{
+    __INFO(
+        "%s memory sink: %zu events recorded, %zu dropped", name,
+        state->record_count, state->records_dropped
+    );
+}
+
+int memory_sink_dump(const struct sink_state_t *state, FILE *stream)
+{
+    int kind = 0;
+    const struct sink_record_t *record = NULL;
+
+    for(size_t i = 0; i < state->record_count; i++)
+    {
+        record = &state->records[i];
+        kind = KIND_FROM_HANDLE(record->handle);
+
+        if(fprintf(
+            stream, "%s %u %u %d\n", kind >= 0 && kind < SINK_DEVICE_COUNT ? device_names[kind] : "unknown",
+            record->event.type, record->event.code, record->event.value
+        ) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+const struct sink_t memory_sink = {
+    .name = "memory",
+    .open = memory_open,
+    .create = make_handle,
+    .destroy = drop_handle,
+    .write = memory_write,
+    .close = memory_close,
+    .print_stats = memory_print_stats
+};
+
+// counting sink
+
+static int counting_write(struct sink_state_t *state, int handle, const struct input_event *events, size_t count)
+{
+    int kind = KIND_FROM_HANDLE(handle);
+
+    state->writes++;
+    state->events += count;
+
+    if(kind < 0 || kind >= SINK_DEVICE_COUNT)
+        return 0;
+
+    for(size_t i = 0; i < count; i++)
+        if(events[i].type < EV_CNT)
+            state->type_events[kind][events[i].type]++;
+    return 0;
+}
+
+static void counting_print_stats(const struct sink_state_t *state, const char *name)
+{
+    __INFO(
+        "%s counting sink: %llu events in %llu writes", name,
+        (unsigned long long)state->events, (unsigned long long)state->writes
+    );
+
+    for(int kind = 0; kind < SINK_DEVICE_COUNT; kind++)
+    {
+        const uint64_t *types = state->type_events[kind];
+        if(types[EV_SYN] + types[EV_KEY] + types[EV_REL] + types[EV_ABS] + types[EV_MSC] == 0)
+            continue;
+
+        __INFO(
+            "%s   %-9s syn %llu, key %llu, rel %llu, abs %llu, msc %llu", name, device_names[kind],
+            (unsigned long long)types[EV_SYN], (unsigned long long)types[EV_KEY],
+            (unsigned long long)types[EV_REL], (unsigned long long)types[EV_ABS],
+            (unsigned long long)types[EV_MSC]
+        );
+    }
+}
+
+const struct sink_t counting_sink = {
+    .name = "counting",
+    .create = make_handle,
+    .destroy = drop_handle,
+    .write = counting_write,
+    .print_stats = counting_print_stats
+};
+
+const struct sink_t *sink_find(const char *name)
+{
+    const struct sink_t *sinks[] = { &uinput_sink, &null_sink, &memory_sink, &counting_sink };
+
+    for(size_t i = 0; i < GET_LEN(sinks); i++)
+        if(strcmp(sinks[i]->name, name) == 0)
+            return sinks[i];
+    return NULL;
+}
@@ -0,0 +1,88 @@
+#ifndef FAKETABLETD_SINK_H__
+#define FAKETABLETD_SINK_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/input.h>
+
+#include "faketabletd.h"
+
+// The virtual devices every tablet gets
+#define SINK_DEVICE_PAD             0
+#define SINK_DEVICE_PEN             1
+#define SINK_DEVICE_MOUSE           2
+#define SINK_DEVICE_KEYBOARD        3
+#define SINK_DEVICE_COUNT           4
+
+// How many events the memory sink holds on to. Anything past that is
+// only counted
+#define SINK_MEMORY_CAPACITY        65536
+
+struct sink_record_t
+{
+    int handle;
+    struct input_event event;
+};
+
+// Per device state, whatever the sink
+struct sink_state_t
+{
+    // Set by the device before creating anything, the uinput sink builds
+    // the pad and pen through the driver's callbacks
+    create_virtual_device_callback_t create_virtual_pad;
+    create_virtual_device_callback_t create_virtual_pen;
+
+    // Counting sink
+    uint64_t writes;
+    uint64_t events;
+    uint64_t type_events[SINK_DEVICE_COUNT][EV_CNT];
+
+    // Memory sink
+    struct sink_record_t *records;
+    size_t record_count;
+    size_t records_dropped;
+};
+
+// Where a device's events end up. Handles are what the drivers get as
+// pad_device, pen_device, etc. For sinks without write they are file
+// descriptors the events get written (or submitted) to, every other sink
+// takes frames through write and makes up handles of its own
+struct sink_t
+{
+    const char *name;
+
+    // Called once before any device is created. Optional
+    int (*open)(struct sink_state_t *state);
+
+    // Returns a handle for a new virtual device of the given kind, or -1
+    int (*create)(struct sink_state_t *state, int kind, struct input_id *id, const char *name);
+    void (*destroy)(struct sink_state_t *state, int handle);
+
+    int (*write)(struct sink_state_t *state, int handle, const struct input_event *events, size_t count);
+
+    // Optional
+    void (*close)(struct sink_state_t *state);
+    void (*print_stats)(const struct sink_state_t *state, const char *name);
+};
+
+// Sends events to the kernel through /dev/uinput
+extern const struct sink_t uinput_sink;
+
+// Throws every event away
+extern const struct sink_t null_sink;
+
+// Keeps every event (up to SINK_MEMORY_CAPACITY) in records
+extern const struct sink_t memory_sink;
+
+// Writes what the memory sink kept to stream, one event per line as
+// "device type code value", so two runs can be diffed
+int memory_sink_dump(const struct sink_state_t *state, FILE *stream);
+
+// Only counts events, per device and type
+extern const struct sink_t counting_sink;
+
+// NULL if there's no sink called name
+const struct sink_t *sink_find(const char *name);
+
+#endif
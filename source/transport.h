@@ -0,0 +1,48 @@
+#ifndef FAKETABLETD_TRANSPORT_H__
+#define FAKETABLETD_TRANSPORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libusb-1.0/libusb.h>
+
+struct device_context_t;
+
+// Whatever gets reports from a tablet (or something pretending to be one)
+// to the driver. open and close run on the main thread. start, stop and
+// is_stopped run on the thread servicing the device's reactor, and so does
+// every device_deliver_report call the transport makes
+struct transport_t
+{
+    const char *name;
+
+    // device is NULL when there's no USB device behind the transport
+    int (*open)(struct device_context_t *ctx, struct libusb_device *device);
+    int (*start)(struct device_context_t *ctx);
+
+    // Stops reading reports, though some might still be on their way back
+    // until is_stopped returns true
+    void (*stop)(struct device_context_t *ctx);
+    bool (*is_stopped)(struct device_context_t *ctx);
+
+    void (*close)(struct device_context_t *ctx);
+
+    // Optional
+    void (*print_stats)(struct device_context_t *ctx);
+
+    // Copies the device's HID report descriptor into buffer and returns
+    // its size, or -1. Optional, only called between open and start
+    int (*get_report_descriptor)(struct device_context_t *ctx, uint8_t *buffer, size_t size);
+};
+
+// Claims the device and reads its interrupt endpoint through libusb
+extern const struct transport_t usb_transport;
+
+// Leaves the device to the kernel and reads its /dev/hidrawN node
+extern const struct transport_t hidraw_transport;
+
+// Plays a captured report stream back
+extern const struct transport_t replay_transport;
+
+#endif
@@ -0,0 +1,141 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+#include "device.h"
+#include "transport.h"
+#include "hidraw.h"
+#include "utilities.h"
+
+// hidraw hands us exactly one report per read, so keep reading until the
+// node runs dry
+static void hidraw_callback(struct reactor_t *reactor, int fd, uint32_t events, void *user_data)
+{
+    ssize_t size = 0;
+    uint8_t buffer[HID_MAX_PACKET_SIZE];
+    struct device_context_t *ctx = (struct device_context_t *)user_data;
+
+    while(!atomic_load(&ctx->closing) && (size = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        if(device_deliver_report(ctx, buffer, size, get_time_ns()) < 0)
+        {
+            atomic_store(&ctx->closing, true);
+            return;
+        }
+    }
+
+    if(atomic_load(&ctx->closing) || (size < 0 && (errno == EAGAIN || errno == EINTR)))
+        return;
+
+    // The node goes away with the device, reads fail with EIO from then on
+    DEVICE_INFO(ctx, "device has been disconnected!");
+    reactor_remove_fd(reactor, fd);
+    atomic_store(&ctx->closing, true);
+}
+
+// Finds and opens the hidraw node for interface 0, which is where the tablet
+// sends its reports
+static int hidraw_open(struct device_context_t *ctx, struct libusb_device *device)
+{
+    int ret = 0;
+    char path[HIDRAW_PATH_SIZE] = {0};
+    unsigned char descriptor_string[50] = {};
+    struct libusb_device_handle *handle = NULL;
+
+    if(hidraw_find(
+        ctx->descriptor.idVendor, ctx->descriptor.idProduct,
+        ctx->bus_number, ctx->device_address, 0,
+        path, sizeof(path)) < 0)
+    {
+        DEVICE_WARNING(ctx, "cannot find hidraw node for device");
+        return -1;
+    }
+
+    // The tablet only switches to its full resolution reports once this
+    // string is read. It goes through the control endpoint, so nothing has
+    // to be claimed or detached, but we do need access to the USB node. If
+    // we don't have it, go on with whatever mode the tablet is in
+    if((ret = libusb_open(device, &handle)) == 0)
+    {
+        __USB_CATCHER(
+            libusb_get_string_descriptor(handle, 0xc8, 0x0409, descriptor_string, sizeof(descriptor_string)),
+            "cannot get descriptor string"
+        );
+        libusb_close(handle);
+    }
+    else
+        DEVICE_WARNING(ctx, "cannot open device to switch its report mode: %s", libusb_strerror(ret));
+
+    if((ctx->hidraw_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) < 0)
+    {
+        DEVICE_WARNING(ctx, "cannot open \"%s\": %s", path, strerror(errno));
+        return errno == EACCES ? LIBUSB_ERROR_ACCESS : -1;
+    }
+
+    DEVICE_INFO(ctx, "reading reports from %s", path);
+    return 0;
+}
+
+static int hidraw_start(struct device_context_t *ctx)
+{
+    return reactor_add_fd(ctx->reactor, ctx->hidraw_fd, EPOLLIN, hidraw_callback, ctx);
+}
+
+static void hidraw_stop(struct device_context_t *ctx)
+{
+    if(ctx->reactor != NULL)
+        reactor_remove_fd(ctx->reactor, ctx->hidraw_fd);
+}
+
+// Reads are synchronous, once we stop nothing is left in flight
+static bool hidraw_is_stopped(struct device_context_t *ctx)
+{
+    return true;
+}
+
+static void hidraw_close(struct device_context_t *ctx)
+{
+    if(ctx->hidraw_fd >= 0)
+    {
+        if(ctx->reactor != NULL)
+            reactor_remove_fd(ctx->reactor, ctx->hidraw_fd);
+        close(ctx->hidraw_fd);
+        ctx->hidraw_fd = -1;
+    }
+}
+
+// The kernel already has the descriptor, no need to bother the device
+static int hidraw_get_report_descriptor(struct device_context_t *ctx, uint8_t *buffer, size_t size)
+{
+    int descriptor_size = 0;
+    struct hidraw_report_descriptor descriptor;
+
+    if(ioctl(ctx->hidraw_fd, HIDIOCGRDESCSIZE, &descriptor_size) < 0)
+    {
+        DEVICE_WARNING(ctx, "cannot get report descriptor size: %s", strerror(errno));
+        return -1;
+    }
+
+    descriptor.size = MIN((size_t)descriptor_size, MIN(size, sizeof(descriptor.value)));
+    if(ioctl(ctx->hidraw_fd, HIDIOCGRDESC, &descriptor) < 0)
+    {
+        DEVICE_WARNING(ctx, "cannot get report descriptor: %s", strerror(errno));
+        return -1;
+    }
+
+    memcpy(buffer, descriptor.value, descriptor.size);
+    return descriptor.size;
+}
+
+const struct transport_t hidraw_transport = (const struct transport_t)
+{
+    .name           = "hidraw",
+    .open           = hidraw_open,
+    .start          = hidraw_start,
+    .stop           = hidraw_stop,
+    .is_stopped     = hidraw_is_stopped,
+    .close          = hidraw_close,
+    .get_report_descriptor = hidraw_get_report_descriptor,
+};
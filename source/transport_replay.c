@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "device.h"
+#include "transport.h"
+#include "utilities.h"
+
+// How many reports we push through per wake up when replaying as fast as
+// possible, so a long capture doesn't keep the reactor from anything else
+#define REPLAY_BATCH_SIZE           256
+
+// How often we check whether the translator is done with the last reports
+#define REPLAY_DRAIN_INTERVAL_NS    1000000ULL
+
+// How long we give the translator when the ring is full. Unlike a real
+// tablet we can wait, and dropping reports would make runs differ
+#define REPLAY_BACKOFF_NS           50000ULL
+
+static void replay_finish(struct device_context_t *ctx)
+{
+    uint64_t elapsed = get_time_ns() - ctx->replay_start;
+
+    DEVICE_INFO(
+        ctx, "replayed %zu reports in %.2f ms (%.0f ns per report)", ctx->replay_file.count,
+        elapsed / 1e6, ctx->replay_file.count > 0 ? elapsed / (double)ctx->replay_file.count : 0.0
+    );
+    atomic_store(&ctx->closing, true);
+}
+
+// Reports keep the time between them as captured, moved to when the replay
+// started, so smoothing and prediction see the pen go as fast as it did.
+// Only captures without timestamps get the time they go out at
+static uint64_t replay_timestamp(const struct device_context_t *ctx, const struct report_t *report)
+{
+    if(!ctx->replay_file.has_timestamps)
+        return get_time_ns();
+    return ctx->replay_start + report->timestamp;
+}
+
+static void replay_callback(struct reactor_t *reactor, uint64_t expirations, void *user_data)
+{
+    size_t delivered = 0;
+    bool backlogged = false;
+    uint64_t now = get_time_ns(), due = 0;
+    const struct report_t *report = NULL;
+    struct device_context_t *ctx = (struct device_context_t *)user_data;
+    const bool timed = ctx->options->replay_timing && ctx->replay_file.has_timestamps;
+
+    while(ctx->replay_position < ctx->replay_file.count && !atomic_load(&ctx->closing))
+    {
+        report = &ctx->replay_file.reports[ctx->replay_position];
+
+        if(timed && (due = ctx->replay_start + report->timestamp) > now)
+            break;
+        if(!timed && delivered == REPLAY_BATCH_SIZE)
+            break;
+        if(ctx->options->use_pipeline && report_ring_occupancy(&ctx->ring) >= REPORT_RING_SIZE)
+        {
+            backlogged = true;
+            break;
+        }
+
+        if(device_deliver_report(ctx, report->data, report->size, replay_timestamp(ctx, report)) < 0)
+        {
+            atomic_store(&ctx->closing, true);
+            return;
+        }
+
+        ctx->replay_position++;
+        delivered++;
+    }
+
+    if(atomic_load(&ctx->closing))
+        return;
+
+    // Once everything is out, give the translator (if any) a chance to catch
+    // up before we call it a day
+    if(ctx->replay_position == ctx->replay_file.count)
+    {
+        if(report_ring_occupancy(&ctx->ring) == 0)
+            replay_finish(ctx);
+        else
+            reactor_set_timer(reactor, ctx->replay_timer, REPLAY_DRAIN_INTERVAL_NS, 0);
+        return;
+    }
+
+    if(backlogged)
+        reactor_set_timer(reactor, ctx->replay_timer, REPLAY_BACKOFF_NS, 0);
+    else if(timed)
+        reactor_set_timer(reactor, ctx->replay_timer, due - now, 0);
+    else
+        reactor_set_timer(reactor, ctx->replay_timer, 0, 0);
+}
+
+static int replay_open(struct device_context_t *ctx, struct libusb_device *device)
+{
+    const struct device_options_t *options = ctx->options;
+
+    if(report_file_load(&ctx->replay_file, options->replay_path, options->replay_report_size) < 0)
+        return -1;
+
+    DEVICE_INFO(
+        ctx, "loaded %zu reports from \"%s\" (%s)", ctx->replay_file.count,
+        options->replay_path, report_file_format_name(ctx->replay_file.format)
+    );
+
+    if(options->replay_timing && !ctx->replay_file.has_timestamps)
+        DEVICE_WARNING(ctx, "capture has no timestamps, replaying it as fast as possible");
+
+    ctx->replay_position = 0;
+    ctx->replay_timer = -1;
+    return 0;
+}
+
+static int replay_start(struct device_context_t *ctx)
+{
+    ctx->replay_start = get_time_ns();
+    ctx->replay_timer = reactor_add_timer(ctx->reactor, 0, 0, replay_callback, ctx);
+    return ctx->replay_timer < 0 ? -1 : 0;
+}
+
+static void replay_stop(struct device_context_t *ctx)
+{
+    if(ctx->replay_timer >= 0 && ctx->reactor != NULL)
+        reactor_remove_fd(ctx->reactor, ctx->replay_timer);
+    ctx->replay_timer = -1;
+}
+
+static bool replay_is_stopped(struct device_context_t *ctx)
+{
+    return true;
+}
+
+static void replay_close(struct device_context_t *ctx)
+{
+    replay_stop(ctx);
+    report_file_free(&ctx->replay_file);
+}
+
+const struct transport_t replay_transport = (const struct transport_t)
+{
+    .name           = "replay",
+    .open           = replay_open,
+    .start          = replay_start,
+    .stop           = replay_stop,
+    .is_stopped     = replay_is_stopped,
+    .close          = replay_close,
+};
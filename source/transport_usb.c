@@ -0,0 +1,357 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "device.h"
+#include "transport.h"
+#include "utilities.h"
+
+static void claim_interface_for_handle(struct libusb_device_handle *handle, struct interface_status_t *interface)
+{
+    int ret = 0;
+    // Detach interface from the kernel and claim it for ourselves
+    if(libusb_kernel_driver_active(handle, interface->number) == 1)
+    {
+        ret  = libusb_detach_kernel_driver(handle, interface->number);
+        if(ret < 0 && ret != LIBUSB_ERROR_NOT_FOUND)
+            __USB_CATCHER_CRITICAL(ret, "cannot detach kernel from interface %d", interface->number);
+        interface->detached_from_kernel = true;
+    }
+    else
+        interface->detached_from_kernel = false;
+
+    __CATCHER_CRITICAL(libusb_claim_interface(handle, interface->number), "cannot claim interface %d", interface->number);
+    interface->claimed = true;
+
+    // This part is a little trickier to understand. Basically, we are going to setup the
+    // handle to work with a HID device on this interface. You can actually understand a lot
+    // of what's going on by reading this spec
+    // https://www.usb.org/sites/default/files/hid1_11.pdf
+
+    // Set the device's protocol to report
+    __USB_CATCHER_CRITICAL(libusb_control_transfer(
+        handle,
+        HID_SET_REQUEST_TYPE,
+        HID_SET_PROTOCOL,
+        HID_SET_PROTOCOL_REPORT,
+        interface->number,
+        NULL, 0,
+        HID_TIMEOUT
+    ), "cannot set protocol on interface %d", interface->number);
+
+    // Make sure idle is set to infinity
+    __USB_CATCHER_CRITICAL(libusb_control_transfer(
+        handle,
+        HID_SET_REQUEST_TYPE,
+        HID_SET_IDLE,
+
+        // This makes sure the 8th bit of the word (wValue) is 0,
+        // making the idle duration undefined (it's on the pdf too)
+        0 << 8,
+
+        interface->number,
+        NULL, 0,
+        HID_TIMEOUT
+    ), "cannot set protocol on interface %d", interface->number);
+}
+
+
+
+static void interrupt_transfer_callback(struct libusb_transfer *transfer)
+{
+    int ret = 0;
+    bool terminate = true;
+    uint64_t timestamp = get_time_ns();
+    struct device_context_t *ctx = NULL;
+    if(transfer == NULL) return;
+
+    ctx = (struct device_context_t *)transfer->user_data;
+
+    // If this was the last transfer queued on the endpoint, the device had
+    // nowhere to put its next report until we resubmit
+    if(--ctx->transfers_in_flight == 0 && transfer->status == LIBUSB_TRANSFER_COMPLETED)
+        ctx->transfer_queue_starved++;
+
+    if(atomic_load(&ctx->closing)) return;
+
+    switch (transfer->status)
+    {
+    case LIBUSB_TRANSFER_COMPLETED:
+        ret = device_deliver_report(ctx, transfer->buffer, transfer->actual_length, timestamp);
+        if(!(terminate = ret < 0))
+        {
+            __USB_CATCHER(ret = libusb_submit_transfer(transfer), "cannot resubmit event transfer");
+            if(!(terminate = ret < 0))
+                ctx->transfers_in_flight++;
+        }
+        break;
+
+    // Taken from https://github.com/DIGImend/digimend-userspace-drivers/blob/main/src/dud-translate.c
+#define MAP(_name, _desc)                       \
+    case LIBUSB_TRANSFER_##_name:               \
+        __ERROR(_desc);                         \
+        break
+
+        MAP(ERROR,      "interrupt transfer failed");
+        MAP(TIMED_OUT,  "interrupt transfer timed out");
+        MAP(STALL,      "interrupt transfer halted (endpoint stalled)");
+        MAP(OVERFLOW,   "interrupt transfer overflowed "
+                        "(device sent more data than requested)");
+#undef MAP
+
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        DEVICE_INFO(ctx, "device has been disconnected!");
+        break;
+
+    case LIBUSB_TRANSFER_CANCELLED:
+        break;
+
+    default:
+        __ERROR("Uknown transfer error: %d", transfer->status);
+        break;
+    }
+
+    if(terminate)
+        atomic_store(&ctx->closing, true);
+}
+
+// Point every transfer at its own buffer, sized to the endpoint's real
+// wMaxPacketSize
+static void setup_transfer_buffers(struct device_context_t *ctx)
+{
+    size_t i = 0;
+    int size = libusb_get_max_packet_size(ctx->device, HID_ENDPOINT);
+
+    if(size <= 0)
+    {
+        DEVICE_WARNING(ctx, "cannot get max packet size for endpoint 0x%02x, using %d bytes", HID_ENDPOINT, HID_BUFFER_SIZE);
+        size = HID_BUFFER_SIZE;
+    }
+    ctx->transfer_buffer_size = MIN(size, HID_MAX_PACKET_SIZE);
+
+#if LIBUSB_API_VERSION >= 0x01000105
+    ctx->transfer_dev_mem_size = ctx->transfer_buffer_size * ctx->transfer_count;
+    ctx->transfer_dev_mem = libusb_dev_mem_alloc(ctx->handle, ctx->transfer_dev_mem_size);
+#endif
+
+    if(ctx->transfer_dev_mem == NULL)
+        ctx->transfer_dev_mem_size = 0;
+
+    for(i = 0; i < ctx->transfer_count; i++)
+    {
+        if(ctx->transfer_dev_mem != NULL)
+            ctx->transfer_buffers[i] = ctx->transfer_dev_mem + i * ctx->transfer_buffer_size;
+        else
+            ctx->transfer_buffers[i] = ctx->transfer_pool[i];
+        memset(ctx->transfer_buffers[i], 0, ctx->transfer_buffer_size);
+    }
+
+    DEVICE_INFO(
+        ctx, "using %zu byte transfer buffers from %s", ctx->transfer_buffer_size,
+        ctx->transfer_dev_mem != NULL ? "usbfs memory" : "static pool"
+    );
+}
+
+// Keep several transfers queued on the endpoint so the device always
+// has somewhere to put a report while we are busy with the previous
+// one. usbfs completes them in submission order, so reports still
+// reach the driver in the order they arrived. If one can't be submitted,
+// the ones before it stay in flight until the transport is stopped
+static int usb_start(struct device_context_t *ctx)
+{
+    int ret = 0;
+
+    for(size_t i = 0; i < ctx->transfer_count; i++)
+    {
+        __USB_CATCHER(ret = libusb_submit_transfer(ctx->transfers[i]), "cannot submit device transfer");
+        if(ret < 0)
+            return ret;
+        ctx->transfers_in_flight++;
+    }
+
+    return 0;
+}
+
+// Threaded devices need a libusb context of their own, so their events
+// can be handled without waiting on anybody else. Look the device up again
+// from it
+static struct libusb_device *find_device_in_own_context(struct device_context_t *ctx)
+{
+    ssize_t count = 0, i = 0;
+    struct libusb_device **list = NULL, *found = NULL;
+
+    __USB_CATCHER(libusb_init(&ctx->usb_context), "cannot create libusb context");
+    if(ctx->usb_context == NULL)
+        return NULL;
+
+    __USB_CATCHER(count = libusb_get_device_list(ctx->usb_context, &list), "cannot retreive connected devices");
+    for(i = 0; i < count && found == NULL; i++)
+    {
+        if(libusb_get_bus_number(list[i]) == ctx->bus_number &&
+            libusb_get_device_address(list[i]) == ctx->device_address)
+            found = libusb_ref_device(list[i]);
+    }
+
+    if(list != NULL)
+        libusb_free_device_list(list, true);
+    return found;
+}
+
+// Takes the device away from the kernel and gets the transfer ring ready
+static int usb_open(struct device_context_t *ctx, struct libusb_device *device)
+{
+    int ret = 0;
+    unsigned char descriptor_string[50] = {};
+
+    if(ctx->threaded)
+    {
+        if((ctx->device = find_device_in_own_context(ctx)) == NULL)
+        {
+            DEVICE_WARNING(ctx, "cannot find device on its own libusb context");
+            return LIBUSB_ERROR_NO_DEVICE;
+        }
+    }
+    else
+        ctx->device = libusb_ref_device(device);
+
+    DEVICE_INFO(ctx, "connecting to device");
+    __USB_CATCHER(
+        ret = libusb_open(ctx->device, &ctx->handle),
+        "cannot open device with current handle"
+    );
+    if(ret < 0)
+        return ret;
+    DEVICE_INFO(ctx, "connected!");
+
+    DEVICE_INFO(ctx, "configuring device...");
+    // Claim interfaces 0 and 1 (dunno yet why the two of them but it works so...)
+    claim_interface_for_handle(ctx->handle, &ctx->interface_0);
+    claim_interface_for_handle(ctx->handle, &ctx->interface_1);
+
+    // Get string descriptor, don't know why, but digimend userspace does so...
+    __USB_CATCHER_CRITICAL(
+        libusb_get_string_descriptor(ctx->handle, 0xc8, 0x0409, descriptor_string, sizeof(descriptor_string)),
+        "cannot get descriptor string"
+    );
+
+    setup_transfer_buffers(ctx);
+
+    for(size_t i = 0; i < ctx->transfer_count; i++)
+    {
+        ctx->transfers[i] = libusb_alloc_transfer(0);
+        __CATCHER_CRITICAL(ctx->transfers[i] == NULL ? -1 : 0, "cannot allocate libusb transfer");
+
+        // Register transfer callback
+        libusb_fill_interrupt_transfer(ctx->transfers[i],
+            ctx->handle, HID_ENDPOINT,
+            ctx->transfer_buffers[i], ctx->transfer_buffer_size,
+
+            // Do keep in mind that this function will be handled from another
+            // thread, so terminating the program using exit from
+            // here isn't an option
+            interrupt_transfer_callback,
+
+            ctx, 0
+        );
+    }
+
+    return 0;
+}
+
+static void usb_stop(struct device_context_t *ctx)
+{
+    for(size_t i = 0; i < ctx->transfer_count; i++)
+        if(ctx->transfers[i] != NULL)
+            libusb_cancel_transfer(ctx->transfers[i]);
+}
+
+// Transfers can't be freed while the kernel still owns them
+static bool usb_is_stopped(struct device_context_t *ctx)
+{
+    return ctx->transfers_in_flight == 0;
+}
+
+static void usb_close(struct device_context_t *ctx)
+{
+    for(size_t i = 0; i < HID_MAX_TRANSFERS; i++)
+    {
+        if(ctx->transfers[i] != NULL)
+        {
+            libusb_free_transfer(ctx->transfers[i]);
+            ctx->transfers[i] = NULL;
+        }
+        ctx->transfer_buffers[i] = NULL;
+    }
+    ctx->transfer_queue_starved = 0;
+    ctx->transfers_in_flight = 0;
+
+    if(ctx->transfer_dev_mem != NULL)
+    {
+#if LIBUSB_API_VERSION >= 0x01000105
+        libusb_dev_mem_free(ctx->handle, ctx->transfer_dev_mem, ctx->transfer_dev_mem_size);
+#endif
+        ctx->transfer_dev_mem = NULL;
+        ctx->transfer_dev_mem_size = 0;
+    }
+
+    if(ctx->interface_0.claimed)
+    {
+        libusb_release_interface(ctx->handle, ctx->interface_0.number);
+        ctx->interface_0.claimed = false;
+    }
+    if(ctx->interface_1.claimed)
+    {
+        libusb_release_interface(ctx->handle, ctx->interface_1.number);
+        ctx->interface_1.claimed = false;
+    }
+
+    if(ctx->handle != NULL)
+    {
+        libusb_close(ctx->handle);
+        ctx->handle = NULL;
+    }
+
+    if(ctx->device != NULL)
+    {
+        libusb_unref_device(ctx->device);
+        ctx->device = NULL;
+    }
+
+    if(ctx->usb_context != NULL)
+    {
+        libusb_exit(ctx->usb_context);
+        ctx->usb_context = NULL;
+    }
+}
+
+// Report descriptors are asked for through the interface, not the device
+static int usb_get_report_descriptor(struct device_context_t *ctx, uint8_t *buffer, size_t size)
+{
+    int ret = 0;
+
+    __USB_CATCHER(
+        ret = libusb_control_transfer(ctx->handle,
+            LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_STANDARD | LIBUSB_RECIPIENT_INTERFACE,
+            LIBUSB_REQUEST_GET_DESCRIPTOR, LIBUSB_DT_REPORT << 8, ctx->interface_0.number,
+            buffer, MIN(size, UINT16_MAX), HID_TIMEOUT
+        ),
+        "cannot get report descriptor"
+    );
+    return ret < 0 ? -1 : ret;
+}
+
+static void usb_print_stats(struct device_context_t *ctx)
+{
+    DEVICE_INFO(ctx, "transfer queue ran dry %zu times", ctx->transfer_queue_starved);
+}
+
+const struct transport_t usb_transport = (const struct transport_t)
+{
+    .name           = "libusb",
+    .open           = usb_open,
+    .start          = usb_start,
+    .stop           = usb_stop,
+    .is_stopped     = usb_is_stopped,
+    .close          = usb_close,
+    .print_stats    = usb_print_stats,
+    .get_report_descriptor = usb_get_report_descriptor,
+};
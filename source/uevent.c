@@ -0,0 +1,73 @@
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "uevent.h"
+#include "utilities.h"
+
+#define UEVENT_BUFFER_SIZE      4096
+#define UEVENT_KERNEL_GROUP     1
+
+int uevent_open()
+{
+    int fd = -1, ret = 0;
+    struct sockaddr_nl address = (struct sockaddr_nl){
+        .nl_family = AF_NETLINK,
+        .nl_pid = 0,
+        .nl_groups = UEVENT_KERNEL_GROUP,
+    };
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if(fd < 0)
+        return -1;
+
+    ret = bind(fd, (struct sockaddr *)&address, sizeof(address));
+    if(ret < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void uevent_close(int fd)
+{
+    if(fd >= 0)
+        close(fd);
+}
+
+int uevent_read_usb_add(int fd, uint16_t *vendor_id, uint16_t *product_id)
+{
+    char buffer[UEVENT_BUFFER_SIZE];
+    const char *key = NULL;
+    bool is_add = false, is_usb_device = false;
+    unsigned int vid = 0, pid = 0;
+    bool has_product = false;
+    ssize_t size = 0, i = 0;
+
+    size = recv(fd, buffer, sizeof(buffer) - 1, 0);
+    if(size < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    buffer[size] = '\0';
+
+    // Messages are a "action@devpath" header followed by NUL separated
+    // KEY=VALUE pairs
+    for(i = 0; i < size; i += strlen(&buffer[i]) + 1)
+    {
+        key = &buffer[i];
+
+        if(strcmp(key, "ACTION=add") == 0)
+            is_add = true;
+        else if(strcmp(key, "DEVTYPE=usb_device") == 0)
+            is_usb_device = true;
+        else if(strncmp(key, "PRODUCT=", 8) == 0)
+            has_product = sscanf(key + 8, "%x/%x", &vid, &pid) == 2;
+    }
+
+    if(!is_add || !is_usb_device || !has_product)
+        return 0;
+
+    *vendor_id = (uint16_t)vid;
+    *product_id = (uint16_t)pid;
+    return 1;
+}
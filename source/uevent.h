@@ -0,0 +1,17 @@
+#ifndef FAKETABLETD_UEVENT_H__
+#define FAKETABLETD_UEVENT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Kernel uevents (the same netlink messages udev listens to). We use them
+// to learn about new USB devices when libusb has no hotplug support
+int uevent_open();
+void uevent_close(int fd);
+
+// Reads one pending message from fd. Returns 1 and fills vendor_id and
+// product_id if it announced a new USB device, 0 if it was anything else
+// and -1 on error
+int uevent_read_usb_add(int fd, uint16_t *vendor_id, uint16_t *product_id);
+
+#endif
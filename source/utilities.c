@@ -1,3 +1,5 @@
+#include <stdlib.h>
+
 #include "utilities.h"
 
 bool path_exits(const char *path)
@@ -16,4 +18,44 @@ const char *check_paths(const char *paths[], int len)
     while(len-- > 0)
         if(path_exits(paths[len])) return paths[len];
     return NULL;
-}
\ No newline at end of file
+}
+
+int parse_cpu_list(const char *str, int *cpus, size_t max)
+{
+    size_t count = 0;
+    long first = 0, last = 0;
+    char *end = NULL;
+
+    if(str == NULL)
+        return -1;
+
+    while(*str != '\0')
+    {
+        first = last = strtol(str, &end, 10);
+        if(end == str || first < 0)
+            return -1;
+        str = end;
+
+        if(*str == '-')
+        {
+            last = strtol(++str, &end, 10);
+            if(end == str || last < first)
+                return -1;
+            str = end;
+        }
+
+        for(; first <= last; first++)
+        {
+            if(count >= max)
+                return -1;
+            cpus[count++] = (int)first;
+        }
+
+        if(*str == ',' || *str == ' ')
+            str++;
+        else if(*str != '\0')
+            return -1;
+    }
+
+    return (int)count;
+}
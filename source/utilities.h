@@ -2,6 +2,7 @@
 #define FAKETABLETD_UTILITIES_H__
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
 #include <sys/types.h>
@@ -69,11 +70,20 @@ extern int errno;
 #define SLEEP_FOR_US(_us)                                                   \
 {                                                                           \
     struct timespec req = {                                                 \
-        .tv_nsec = (long)(_us)                                              \
+        .tv_sec = (time_t)((_us) / 1000000),                                \
+        .tv_nsec = (long)((_us) % 1000000) * 1000                           \
     };                                                                      \
     while(nanosleep(&req, &req) == -1 && errno == EINTR);                   \
 }
 
+// Monotonic clock in nanoseconds
+static inline uint64_t get_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 // Mutex helpers
 #define REGISTER_MUTEX_VARIABLE(_type, _name)                               \
     static pthread_mutex_t _name##_mutex;                                   \
@@ -106,4 +116,8 @@ bool path_exits(const char *path);
 bool path_is_dir(const char *path);
 const char *check_paths(const char *paths[], int len);
 
+// Parses a list of cpus like "0,2-3" into cpus. Returns how many were
+// found, or -1 if the list is invalid
+int parse_cpu_list(const char *str, int *cpus, size_t max);
+
 #endif
\ No newline at end of file
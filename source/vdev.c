@@ -1,24 +1,9 @@
+#include <fcntl.h>
 #include <linux/uinput.h>
 
 #include "faketabletd.h"
 #include "utilities.h"
-
-// Send event to device using fd
-#define SEND_INPUT_EVENT(_fd, _type, _code, _value)     \
-{                                                       \
-    ev.type = _type;                                    \
-    ev.code = _code;                                    \
-    ev.value = _value;                                  \
-    ev.time.tv_sec = 0;                                 \
-    ev.time.tv_usec = 0;                                \
-    __STD_CATCHER(                                      \
-        ret = write(_fd, &ev, sizeof(ev)),              \
-        "cannot send event data"                        \
-    );                                                  \
-    if(ret < 0) return -1;                              \
-}
-#define SEND_REPORT(_fd)                                \
-    SEND_INPUT_EVENT(_fd, EV_SYN, SYN_REPORT, 0)
+#include "frame.h"
 
 static inline int get_key_code(char c)
 {
@@ -90,16 +75,17 @@ bool validate_key_presses(const char keys[INI_STRING_SIZE])
     return true;
 }
 
-int simulate_key_presses(int fd, const char keys[INI_STRING_SIZE])
+int simulate_key_presses(struct frame_t *frame, int fd, const char keys[INI_STRING_SIZE])
 {
-    int ret = 0, size = 0;
-    struct input_event ev = (struct input_event){};
+    int size = 0;
 
-#define MAKE_KEY_PRESSES(_in)                                           \
-    size = 0;                                                           \
-    while(size < INI_STRING_SIZE)                                       \
-        SEND_INPUT_EVENT(fd, EV_KEY, get_key_code(keys[size++]), _in);  \
-    SEND_REPORT(fd);
+#define MAKE_KEY_PRESSES(_in)                                                       \
+    size = 0;                                                                       \
+    while(size < INI_STRING_SIZE)                                                   \
+        if(frame_append(frame, fd, EV_KEY, get_key_code(keys[size++]), _in) < 0)    \
+            return -1;                                                              \
+    if(frame_append(frame, fd, EV_SYN, SYN_REPORT, 0) < 0)                          \
+        return -1;
 
     MAKE_KEY_PRESSES(1);
     MAKE_KEY_PRESSES(0);
@@ -107,4 +93,87 @@ int simulate_key_presses(int fd, const char keys[INI_STRING_SIZE])
 #undef MAKE_KEY_PRESSES
 
     return 0;
-}
\ No newline at end of file
+}
+
+// We use this to simulate mouse scroll events for the scroll wheel
+int create_virtual_mouse()
+{
+    int ret = 0, mouse_device = -1;
+    struct uinput_setup input_setup = (struct uinput_setup){};
+
+    __STD_CATCHER_CRITICAL(
+        mouse_device = open(FAKETABLETD_UINPUT_PATH, FAKETABLETD_UINTPUT_OFLAGS),
+        "cannot open virtual mouse file"
+    );
+
+#define __IOCTL( ...) ret = ioctl(mouse_device, __VA_ARGS__); if(ret < 0) break;
+    do
+    {
+        // Setup mouse events, buttons, scroll wheel and movement
+        __IOCTL(UI_SET_EVBIT, EV_KEY);
+        __IOCTL(UI_SET_KEYBIT, BTN_LEFT);
+        __IOCTL(UI_SET_KEYBIT, BTN_RIGHT);
+        __IOCTL(UI_SET_KEYBIT, BTN_MIDDLE);
+        __IOCTL(UI_SET_EVBIT, EV_REL);
+        __IOCTL(UI_SET_RELBIT, REL_X);
+        __IOCTL(UI_SET_RELBIT, REL_Y);
+        __IOCTL(UI_SET_RELBIT, REL_WHEEL);
+        __IOCTL(UI_SET_RELBIT, REL_WHEEL_HI_RES);
+
+        input_setup.id.bustype = BUS_USB;
+        input_setup.id.vendor = 0x1233;
+        input_setup.id.product = FAKETABLETD_VID;
+        strcpy(input_setup.name, FAKETABLETD_NAME " Mouse");
+
+        __IOCTL(UI_DEV_SETUP, &input_setup);
+        __IOCTL(UI_DEV_CREATE);
+
+    } while (0);
+#undef __IOCTL
+    if(ret < 0)
+    {
+        close(mouse_device);
+        __STD_CATCHER_CRITICAL(ret, "error creating virtual mouse");
+    }
+    
+    return mouse_device;
+}
+
+// We use this to simulate keyboard presses
+int create_virtual_keyboard()
+{
+    int ret = 0, keyboard_device = -1;
+    struct uinput_setup input_setup = (struct uinput_setup){};
+
+    __STD_CATCHER_CRITICAL(
+        keyboard_device = open(FAKETABLETD_UINPUT_PATH, FAKETABLETD_UINTPUT_OFLAGS),
+        "cannot open virtual keyboard file"
+    );
+
+#define __IOCTL( ...) ret = ioctl(keyboard_device, __VA_ARGS__); if(ret < 0) break;
+    do
+    {
+        // Setup mouse events, buttons, scroll wheel and movement
+        __IOCTL(UI_SET_EVBIT, EV_KEY);
+        for(int i = KEY_RESERVED; i < KEY_F24; i++)
+        { __IOCTL(UI_SET_KEYBIT, i); }
+
+        input_setup.id.bustype = BUS_USB;
+        input_setup.id.vendor = 0x1232;
+        input_setup.id.product = FAKETABLETD_VID;
+        strcpy(input_setup.name, FAKETABLETD_NAME " Keyboard");
+
+        __IOCTL(UI_DEV_SETUP, &input_setup);
+        __IOCTL(UI_DEV_CREATE);
+
+    } while (0);
+#undef __IOCTL
+
+    if(ret < 0)
+    {
+        close(keyboard_device);
+        __STD_CATCHER_CRITICAL(ret, "error creating virtual keyboard");
+    }
+    
+    return keyboard_device;
+}